@@ -19,6 +19,7 @@
 
 #include "utils.hpp"
 #include "alternating.hpp"
+#include "telemetry.hpp"
 
 unsigned get_max_u_disj_size(spot::formula f) {
 	if (f.is_boolean()) {
@@ -67,7 +68,7 @@ bool is_mergeable(SLAA* slaa, spot::formula f) {
 		for (auto& edge_id : slaa->get_state_edges(state_id)) {
 			auto t = slaa->get_edge(edge_id);
 			//check t is a loop
-			auto tar_states = t->get_targets();
+			const auto& tar_states = t->get_targets();
 			std::set<spot::formula> targets;
 			for (auto& tar_state : tar_states) {
 				targets.insert(slaa->state_name(tar_state));
@@ -91,6 +92,69 @@ bool is_mergeable(SLAA* slaa, spot::formula f) {
 	return true;
 }
 
+// the APs occurring together in the state formulae of the translated
+// formula, indexed by each of them (-A flag)
+std::map<spot::formula, std::vector<spot::formula>> ap_clusters;
+
+// groups the APs of f so that the APs appearing in one maximal state
+// subformula end up in one cluster; the clusters and the APs in them
+// keep the order of the first occurrence
+void compute_ap_clusters(spot::formula f) {
+	std::vector<std::vector<spot::formula>> clusters;
+	std::map<spot::formula, unsigned> cluster_of;
+
+	f.traverse([&](spot::formula g) {
+		if (!g.is_boolean()) {
+			return false;
+		}
+
+		std::vector<spot::formula> aps;
+		g.traverse([&](spot::formula h) {
+			if (h.is(spot::op::ap)) {
+				aps.push_back(h);
+			}
+			return false;
+		});
+
+		// the lowest cluster containing some of the APs takes over the others
+		unsigned target = clusters.size();
+		for (auto& ap : aps) {
+			auto it = cluster_of.find(ap);
+			if (it != cluster_of.end() && it->second < target) {
+				target = it->second;
+			}
+		}
+
+		if (target == clusters.size()) {
+			clusters.emplace_back();
+		}
+
+		for (auto& ap : aps) {
+			auto it = cluster_of.find(ap);
+			if (it == cluster_of.end()) {
+				clusters[target].push_back(ap);
+				cluster_of[ap] = target;
+			} else if (it->second != target) {
+				auto source = it->second;
+				for (auto& moved : clusters[source]) {
+					clusters[target].push_back(moved);
+					cluster_of[moved] = target;
+				}
+				clusters[source].clear();
+			}
+		}
+
+		return true;
+	});
+
+	ap_clusters.clear();
+	for (auto& cluster : clusters) {
+		for (auto& ap : cluster) {
+			ap_clusters[ap] = cluster;
+		}
+	}
+}
+
 void register_ap_from_boolean_formula(SLAA* slaa, spot::formula f) {
 	// recursively register APs from a state formula f
 	if (f.is(spot::op::And) || f.is(spot::op::Or)) {
@@ -98,8 +162,340 @@ void register_ap_from_boolean_formula(SLAA* slaa, spot::formula f) {
 			register_ap_from_boolean_formula(slaa, f[i]);
 		}
 	} else {
-		slaa->spot_aut->register_ap((f.is(spot::op::Not) ? spot::formula::Not(f) : f).ap_name());
+		auto ap = f.is(spot::op::Not) ? spot::formula::Not(f) : f;
+
+		// with -A1, the whole cluster gets consecutive BDD variables
+		// (registering an AP for the second time does nothing)
+		auto cluster = ap_clusters.find(ap);
+		if (o_ap_clustering && cluster != ap_clusters.end()) {
+			for (auto& related : cluster->second) {
+				slaa->spot_aut->register_ap(related);
+			}
+		}
+
+		slaa->spot_aut->register_ap(ap.ap_name());
+	}
+}
+
+// larger fragments are not cached; this keeps the copying linear in the
+// size of the SLAA even for deeply nested formulae
+const unsigned slaa_fragment_max_states = 64;
+// the least recently used fragments are evicted above this many cached states
+const unsigned slaa_fragment_cache_max_states = 1 << 16;
+
+typedef std::pair<spot::formula, std::string> slaa_fragment_key;
+
+typedef struct {
+	slaa_fragment fragment;
+	std::list<slaa_fragment_key>::iterator lru_pos;
+} slaa_fragment_entry;
+
+// the SLAA fragments cached across formulae, indexed by the subformula
+// and the options that affect the construction
+std::map<slaa_fragment_key, slaa_fragment_entry> slaa_fragment_cache;
+// the keys of the cache, the most recently used first
+std::list<slaa_fragment_key> slaa_fragment_lru;
+// the number of states in all cached fragments
+unsigned slaa_fragment_cache_states = 0;
+// the dictionary the cached labels belong to
+spot::bdd_dict_ptr slaa_fragment_cache_dict = nullptr;
+
+// returns the values of options that affect make_alternating_recursive
+std::string slaa_construction_options() {
+	return std::to_string(o_slaa_trans_red) + "," + std::to_string(o_slaa_determ) + ","
+		+ std::to_string(o_u_merge_level) + "," + std::to_string(o_g_merge_level) + ","
+		+ std::to_string(o_disj_merging) + "," + std::to_string(o_x_single_succ);
+}
+
+// returns true if the fragment cache can be used for the given SLAA
+bool slaa_fragment_cache_enabled(SLAA* slaa) {
+	// without G-merging, the marks of a subformula depend on the whole formula
+	if (!o_slaa_cache || o_g_merge_level == 0 || o_mergeable_info != 0) {
+		return false;
+	}
+
+	if (slaa_fragment_cache_dict != slaa->spot_bdd_dict) {
+		clear_slaa_fragment_cache();
+		slaa_fragment_cache_dict = slaa->spot_bdd_dict;
+	}
+
+	return true;
+}
+
+void clear_slaa_fragment_cache() {
+	slaa_fragment_cache.clear();
+	slaa_fragment_lru.clear();
+	slaa_fragment_cache_states = 0;
+	if (slaa_fragment_cache_dict != nullptr) {
+		slaa_fragment_cache_dict->unregister_all_my_variables(&slaa_fragment_cache);
+		slaa_fragment_cache_dict = nullptr;
+	}
+}
+
+// stores the states the state of f depends on into the cache
+void cache_slaa_fragment(SLAA* slaa, spot::formula f, unsigned state_id) {
+	// which formula owns each mark
+	std::map<acc_mark, spot::formula> mark_owner;
+	for (auto& ac : slaa->acc) {
+		mark_owner[ac.second.fin] = ac.first;
+		for (auto mark : ac.second.fin_disj) {
+			mark_owner[mark] = ac.first;
+		}
+		if (ac.second.inf != -1U) {
+			mark_owner[ac.second.inf] = ac.first;
+		}
+	}
+
+	// collect the states reachable from f and the owners of all marks used on their edges
+	std::map<unsigned, unsigned> local_id;
+	std::vector<unsigned> fragment_states = { state_id };
+	local_id[state_id] = 0;
+	std::set<acc_mark> used_marks;
+	std::set<acc_mark> edge_marks;
+
+	auto add_state = [&](unsigned s) {
+		if (local_id.count(s) == 0) {
+			local_id[s] = fragment_states.size();
+			fragment_states.push_back(s);
+		}
+	};
+
+	for (unsigned i = 0; i < fragment_states.size(); ++i) {
+		if (fragment_states.size() > slaa_fragment_max_states) {
+			return;
+		}
+
+		unsigned s = fragment_states[i];
+
+		auto it = slaa->acc.find(slaa->state_name(s));
+		if (it != slaa->acc.end()) {
+			used_marks.insert(it->second.fin);
+			used_marks.insert(it->second.fin_disj.begin(), it->second.fin_disj.end());
+		}
+
+		for (auto& edge_id : slaa->get_state_edges(s)) {
+			auto edge = slaa->get_edge(edge_id);
+			for (auto t : edge->get_targets()) {
+				add_state(t);
+			}
+			for (auto mark : edge->get_marks()) {
+				used_marks.insert(mark);
+				edge_marks.insert(mark);
+				auto owner = mark_owner.find(mark);
+				if (owner == mark_owner.end() || !slaa->state_exists(owner->second)) {
+					// we cannot renumber a mark that belongs to no state
+					return;
+				}
+				add_state(slaa->get_state_id(owner->second));
+			}
+		}
+	}
+
+	if (fragment_states.size() > slaa_fragment_max_states) {
+		return;
+	}
+
+	// G-merging gives a U-subformula its Inf mark only when it builds the
+	// G-formula, possibly after the U-subformula itself has been cached;
+	// the mark is kept only in fragments whose edges use it, so that the
+	// fragments without the G-formula match a fresh translation
+	auto has_inf = [&edge_marks](const SLAA::acc_phi& ac) {
+		return ac.inf != -1U && edge_marks.count(ac.inf) > 0;
+	};
+
+	std::map<acc_mark, acc_mark> local_mark;
+	for (auto mark : used_marks) {
+		local_mark.insert(std::make_pair(mark, local_mark.size()));
+	}
+
+	slaa_fragment fragment;
+	const auto& inf_marks = slaa->get_inf_marks();
+	for (auto mark : used_marks) {
+		if (inf_marks.count(mark) > 0) {
+			fragment.inf_marks.insert(local_mark[mark]);
+		}
+	}
+
+	for (auto s : fragment_states) {
+		auto g = slaa->state_name(s);
+		fragment.states.push_back(g);
+
+		std::vector<fragment_edge> edges;
+		for (auto& edge_id : slaa->get_state_edges(s)) {
+			auto edge = slaa->get_edge(edge_id);
+			fragment_edge e = { edge->get_label(), id_set(), id_set() };
+			for (auto t : edge->get_targets()) {
+				e.targets.insert(local_id[t]);
+			}
+			for (auto mark : edge->get_marks()) {
+				e.marks.insert(local_mark[mark]);
+			}
+			edges.push_back(e);
+		}
+		fragment.edges.push_back(edges);
+
+		auto it = slaa->acc.find(g);
+		if (it != slaa->acc.end()) {
+			SLAA::acc_phi ac = { local_mark[it->second.fin], -1U, {} };
+			if (has_inf(it->second)) {
+				ac.inf = local_mark[it->second.inf];
+			}
+			for (auto mark : it->second.fin_disj) {
+				ac.fin_disj.insert(local_mark[mark]);
+			}
+			fragment.acc[g] = ac;
+		}
+	}
+
+	for (auto& kv : slaa->get_dom_states()) {
+		if (local_id.count(kv.first) > 0) {
+			for (auto weak : kv.second) {
+				if (local_id.count(weak) > 0) {
+					fragment.dom_states.push_back(std::make_pair(local_id[kv.first], local_id[weak]));
+				}
+			}
+		}
+	}
+
+	// keep the APs of f registered so that the labels stay valid
+	std::set<spot::formula> f_aps;
+	spot::atomic_prop_collect(f, &f_aps);
+	for (auto& ap : slaa->spot_aut->ap()) {
+		if (f_aps.count(ap) > 0) {
+			fragment.aps.push_back(ap);
+			slaa->spot_bdd_dict->register_proposition(ap, &slaa_fragment_cache);
+		}
+	}
+
+	auto key = std::make_pair(f, slaa_construction_options());
+	auto cached = slaa_fragment_cache.find(key);
+	if (cached != slaa_fragment_cache.end()) {
+		slaa_fragment_cache_states -= cached->second.fragment.states.size();
+		slaa_fragment_lru.erase(cached->second.lru_pos);
+		slaa_fragment_cache.erase(cached);
+	}
+
+	slaa_fragment_cache_states += fragment.states.size();
+	slaa_fragment_lru.push_front(key);
+	slaa_fragment_cache[key] = { std::move(fragment), slaa_fragment_lru.begin() };
+
+	// the APs of the evicted fragments stay registered until the cache is cleared
+	while (slaa_fragment_cache_states > slaa_fragment_cache_max_states) {
+		auto evicted = slaa_fragment_cache.find(slaa_fragment_lru.back());
+		slaa_fragment_cache_states -= evicted->second.fragment.states.size();
+		slaa_fragment_cache.erase(evicted);
+		slaa_fragment_lru.pop_back();
+	}
+}
+
+// copies the cached fragment of f into the SLAA, if there is one
+// returns the state of f
+maybe<unsigned> load_slaa_fragment(SLAA* slaa, spot::formula f) {
+	auto it = slaa_fragment_cache.find(std::make_pair(f, slaa_construction_options()));
+	if (it == slaa_fragment_cache.end()) {
+		return maybe<unsigned>::nothing();
+	}
+	slaa_fragment_lru.splice(slaa_fragment_lru.begin(), slaa_fragment_lru, it->second.lru_pos);
+	const auto& fragment = it->second.fragment;
+
+	// map the local marks to the marks of the SLAA; the formulae already
+	// translated in the SLAA keep their marks, the others get new ones
+	std::map<acc_mark, acc_mark> mark_of;
+	std::vector<acc_mark> new_marks;
+	std::vector<std::pair<spot::formula, acc_mark>> new_inf_marks;
+	for (auto& kv : fragment.acc) {
+		if (!slaa->state_exists(kv.first)) {
+			new_marks.push_back(kv.second.fin);
+			new_marks.insert(new_marks.end(), kv.second.fin_disj.begin(), kv.second.fin_disj.end());
+			if (kv.second.inf != -1U) {
+				new_marks.push_back(kv.second.inf);
+			}
+			continue;
+		}
+
+		auto existing = slaa->acc.find(kv.first);
+		if (existing == slaa->acc.end() || existing->second.fin_disj.size() != kv.second.fin_disj.size()) {
+			// the SLAA was built differently; do not mix the constructions
+			return maybe<unsigned>::nothing();
+		}
+
+		mark_of[kv.second.fin] = existing->second.fin;
+		auto disj_it = existing->second.fin_disj.begin();
+		for (auto mark : kv.second.fin_disj) {
+			mark_of[mark] = *disj_it;
+			++disj_it;
+		}
+		if (kv.second.inf != -1U) {
+			if (existing->second.inf != -1U) {
+				mark_of[kv.second.inf] = existing->second.inf;
+			} else {
+				new_inf_marks.push_back(std::make_pair(kv.first, kv.second.inf));
+			}
+		}
+	}
+
+	// now the fragment is going to be used, change the SLAA
+	for (auto& ap : fragment.aps) {
+		slaa->spot_aut->register_ap(ap);
+	}
+
+	auto& ac = slaa->spot_aut->acc();
+	for (auto mark : new_marks) {
+		mark_of[mark] = ac.add_set();
+	}
+	for (auto& rec : new_inf_marks) {
+		mark_of[rec.second] = slaa->acc[rec.first].inf = ac.add_set();
+	}
+	for (auto mark : fragment.inf_marks) {
+		slaa->remember_inf_mark(mark_of[mark]);
+	}
+
+	std::vector<unsigned> state_of;
+	std::vector<bool> is_new;
+	for (auto& g : fragment.states) {
+		is_new.push_back(!slaa->state_exists(g));
+		state_of.push_back(slaa->get_state_id(g));
 	}
+
+	for (unsigned i = 0; i < fragment.states.size(); ++i) {
+		if (!is_new[i]) {
+			continue;
+		}
+
+		auto acc_it = fragment.acc.find(fragment.states[i]);
+		if (acc_it != fragment.acc.end()) {
+			auto& local = acc_it->second;
+			auto& target = slaa->acc[fragment.states[i]];
+			target.fin = mark_of[local.fin];
+			target.inf = local.inf == -1U ? -1U : mark_of[local.inf];
+			target.fin_disj.clear();
+			for (auto mark : local.fin_disj) {
+				target.fin_disj.insert(mark_of[mark]);
+			}
+		}
+
+		for (auto& e : fragment.edges[i]) {
+			id_set targets;
+			for (auto t : e.targets) {
+				targets.insert(state_of[t]);
+			}
+			id_set marks;
+			for (auto mark : e.marks) {
+				marks.insert(mark_of[mark]);
+			}
+			slaa->add_edge_unchecked(state_of[i], e.label, targets, marks);
+		}
+	}
+
+	// each pair was registered by the construction of one of its states;
+	// the pairs of states that were already in the SLAA are there already
+	for (auto& p : fragment.dom_states) {
+		if (is_new[p.first] || is_new[p.second]) {
+			slaa->register_dom_states(state_of[p.first], state_of[p.second], o_slaa_trans_red);
+		}
+	}
+
+	return maybe<unsigned>::just(state_of[0]);
 }
 
 unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
@@ -107,11 +503,20 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 		// we already have a state for f
 		return slaa->get_state_id(f);
 	} else {
+		// the subformula may have been translated for a previous formula
+		bool use_cache = !f.is_boolean() && slaa_fragment_cache_enabled(slaa);
+		if (use_cache) {
+			auto cached = load_slaa_fragment(slaa, f);
+			if (cached.isJust()) {
+				return cached.fromJust();
+			}
+		}
+
 		// create a new state
 		unsigned state_id = slaa->get_state_id(f);
 
 		if (f.is_tt()) {
-			slaa->add_edge(state_id, bdd_true(), std::set<unsigned>());
+			slaa->add_edge(state_id, bdd_true(), id_set());
 		} else if (f.is_ff()) {
 			// NOP
 		} else if (f.is_boolean()) {
@@ -119,7 +524,7 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 			register_ap_from_boolean_formula(slaa, f);
 
 			// add the only edge to nowhere
-			slaa->add_edge(state_id, spot::formula_to_bdd(f, slaa->spot_bdd_dict, slaa->spot_aut), std::set<unsigned>());
+			slaa->add_edge(state_id, spot::formula_to_bdd(f, slaa->spot_bdd_dict, slaa->spot_aut), id_set());
 		} else if (f.is(spot::op::And)) {
 			std::set<std::set<unsigned>> conj_edges;
 			// create a state for each conjunct
@@ -131,6 +536,9 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 			for (auto& edge : product) {
 				slaa->add_edge(state_id, edge);
 			}
+			if (conj_edges.size() > 1) {
+				slaa->release_edges(product);
+			}
 		} else if (f.is(spot::op::Or)) {
 			// create a state for each disjunct
 			bdd state_labels_disj = bddfalse;
@@ -149,7 +557,7 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 				bdd this_state_labels = bddfalse;
 				if (o_disj_merging && same_labels) {
 					for (auto edge_id : fi_state_edges) {
-						auto targets = slaa->get_edge(edge_id)->get_targets();
+						const auto& targets = slaa->get_edge(edge_id)->get_targets();
 						if (std::find(std::begin(targets), std::end(targets), fi_st_id) != std::end(targets)) {
 							this_state_labels = bdd_or(this_state_labels, slaa->get_edge(edge_id)->get_label());
 							if (targets.size() > 1) {
@@ -195,15 +603,14 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 							targets.insert(state_id);
 
 							// add each mark from [min_disj_mark .. min_disj_mark + f_bar_size) except for min_disj_mark + i
-							std::set<acc_mark> marks;
+							id_set marks;
 							for (unsigned j = min_disj_mark; j < min_disj_mark + f_bar_size; ++j) {
 								if (j != min_disj_mark + i) {
 									marks.insert(j);
 								}
 							}
 
-							auto orig_marks = edge->get_marks();
-							marks.insert(std::begin(orig_marks), std::end(orig_marks));
+							marks.unite(edge->get_marks());
 
 							slaa->add_edge(state_id, slaa->get_edge(edge_id)->get_label(), targets, marks);
 						} else {
@@ -223,14 +630,14 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 		} else if (f.is(spot::op::X)) {
 			if (o_x_single_succ) {
 				// translate X φ as (X φ) --tt--> (φ)
-				std::set<unsigned> target_set = { make_alternating_recursive(slaa, f[0]) };
+				id_set target_set = { make_alternating_recursive(slaa, f[0]) };
 				slaa->add_edge(state_id, bdd_true(), target_set);
 			} else {
 				// we add an universal edge to all states in each disjunct
 				auto f_dnf = f_bar(f[0]);
 
 				for (auto& g_set : f_dnf) {
-					std::set<unsigned> target_set;
+					id_set target_set;
 					for (auto& g : g_set) {
 						target_set.insert(make_alternating_recursive(slaa, g));
 					}
@@ -335,6 +742,14 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 				for (auto edge_id : phi_product) {
 					slaa->add_edge(state_id, edge_id);
 				}
+
+				// the copied edges and their product are not needed anymore
+				if (edges_for_product.size() > 1) {
+					slaa->release_edges(phi_product);
+				}
+				for (auto& phi_edges : edges_for_product) {
+					slaa->release_edges(phi_edges);
+				}
 			} else {
 				// use traditional construction
 				std::set<unsigned> left_edges = slaa->get_state_edges(left);
@@ -346,10 +761,15 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 				// remember the mark-discarding product should be used
 				for (auto& right_edge : right_edges) {
 					for (auto& left_edge : left_edges) {
-						slaa->add_edge(state_id, slaa->edge_product(right_edge, left_edge, false));
+						unsigned p = slaa->edge_product(right_edge, left_edge, false);
+						slaa->add_edge(state_id, p);
+						slaa->release_edge(p);
 					}
-					slaa->add_edge(state_id, slaa->edge_product(right_edge, loop_id, false));
+					unsigned p = slaa->edge_product(right_edge, loop_id, false);
+					slaa->add_edge(state_id, p);
+					slaa->release_edge(p);
 				}
+				slaa->release_edge(loop_id);
 			}
 		} else if (f.is(spot::op::U)) {
 			auto& ac = slaa->spot_aut->acc();
@@ -381,8 +801,8 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 				slaa->add_edge(
 					state_id,
 					spot::formula_to_bdd(f[0], slaa->spot_bdd_dict, slaa->spot_aut),
-					std::set<unsigned>({ state_id }),
-					std::set<unsigned>({ m_fin })
+					id_set({ state_id }),
+					id_set({ m_fin })
 				);
 				slaa->register_dom_states(right, state_id, 1);
 
@@ -400,7 +820,7 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 						);
 						slaa->register_dom_states(product_state, state_id, 1);
 						auto product_edges = slaa->get_state_edges(product_state);
-						std::set<unsigned> m_state_ids;
+						id_set m_state_ids;
 						for (auto& m_formula : m) {
 							m_state_ids.insert(make_alternating_recursive(slaa, m_formula));
 						}
@@ -409,7 +829,7 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 						if (o_u_merge_level == 3) {
 							// we won't merge if there is a looping alternating transition
 							for (auto& edge_id : product_edges) {
-								auto edge_targets = slaa->get_edge(edge_id)->get_targets();
+								const auto& edge_targets = slaa->get_edge(edge_id)->get_targets();
 
 								if (edge_targets.count(product_state) > 0 && edge_targets.size() >= 2) {
 									merge = false;
@@ -420,8 +840,8 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 
 						for (auto& edge_id : product_edges) {
 							auto edge = slaa->get_edge(edge_id);
-							auto p = edge->get_targets();
-							if (o_u_merge_level == 1 && p == m_state_ids || o_u_merge_level >= 2 && merge && std::includes(p.begin(), p.end(), m_state_ids.begin(), m_state_ids.end())) {
+							const auto& p = edge->get_targets();
+							if (o_u_merge_level == 1 && p == m_state_ids || o_u_merge_level >= 2 && merge && p.includes(m_state_ids)) {
 								++states_with_loop;
 								break;
 							}
@@ -453,7 +873,7 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 				unsigned m_mark = mark;
 				for (auto& m : f_dnf) {
 					// set of state IDs of M
-					std::set<unsigned> m_state_ids;
+					id_set m_state_ids;
 					for (auto& m_formula : m) {
 						m_state_ids.insert(make_alternating_recursive(slaa, m_formula));
 					}
@@ -469,7 +889,7 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 					if (o_u_merge_level == 3) {
 						// we won't merge if there is a looping alternating transition
 						for (auto& edge_id : product_edges) {
-							auto edge_targets = slaa->get_edge(edge_id)->get_targets();
+							const auto& edge_targets = slaa->get_edge(edge_id)->get_targets();
 								if (edge_targets.count(product_state) > 0 && edge_targets.size() >= 2) {
 								merge = false;
 								break;
@@ -481,9 +901,9 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 					for (auto& edge_id : product_edges) {
 						auto edge = slaa->get_edge(edge_id);
 
-						auto p = edge->get_targets();
+						const auto& p = edge->get_targets();
 						// does M ⊆ P hold?
-						if ((o_u_merge_level == 1 && p == m_state_ids) || (o_u_merge_level >= 2 && merge && std::includes(p.begin(), p.end(), m_state_ids.begin(), m_state_ids.end()))) {
+						if ((o_u_merge_level == 1 && p == m_state_ids) || (o_u_merge_level >= 2 && merge && p.includes(m_state_ids))) {
 							// yes so new target set is P ∖ M plus loop to our state
 							std::set<unsigned> new_edge_targets;
 							auto net_it = std::set_difference(
@@ -534,21 +954,34 @@ unsigned make_alternating_recursive(SLAA* slaa, spot::formula f) {
 					slaa->get_edge(p)->clear_marks();
 					slaa->get_edge(p)->add_mark(fin);
 					slaa->add_edge(state_id, p);
+					slaa->release_edge(p);
 				}
+				slaa->release_edge(loop_id);
 			}
 		}
 
+		if (use_cache) {
+			cache_slaa_fragment(slaa, f, state_id);
+		}
+
 		return state_id;
 	}
 }
 
 SLAA* make_alternating(spot::formula f, spot::bdd_dict_ptr dict) {
-	SLAA* slaa = new SLAA(f, dict);
+	phase_telemetry telemetry("make_alternating");
+
+	// freed if the construction throws (e.g. on too many acceptance sets)
+	std::unique_ptr<SLAA> slaa(new SLAA(f, dict));
 
 	max_u_disj_size = get_max_u_disj_size(f);
 
+	if (o_ap_clustering) {
+		compute_ap_clusters(f);
+	}
+
 	if (o_single_init_state) {
-		std::set<unsigned> init_set = { make_alternating_recursive(slaa, f) };
+		std::set<unsigned> init_set = { make_alternating_recursive(slaa.get(), f) };
 		slaa->add_init_set(init_set);
 	} else {
 		std::set<std::set<spot::formula>> f_dnf = f_bar(f);
@@ -556,7 +989,7 @@ SLAA* make_alternating(spot::formula f, spot::bdd_dict_ptr dict) {
 		for (auto& g_set : f_dnf) {
 			std::set<unsigned> init_set;
 			for (auto& g : g_set) {
-				unsigned init_state_id = make_alternating_recursive(slaa, g);
+				unsigned init_state_id = make_alternating_recursive(slaa.get(), g);
 				init_set.insert(init_state_id);
 			}
 			slaa->add_init_set(init_set);
@@ -569,5 +1002,8 @@ SLAA* make_alternating(spot::formula f, spot::bdd_dict_ptr dict) {
 		slaa->apply_extended_domination();
 	}
 
-	return slaa;
+	telemetry.count("slaa_states", slaa->states_count());
+	telemetry.count("slaa_edges", slaa->edges_count());
+
+	return slaa.release();
 }
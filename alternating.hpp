@@ -21,12 +21,18 @@
 #define ALTERNATING_H
 #include "utils.hpp"
 #include "automaton.hpp"
+#include <spot/tl/apcollect.hh>
 #include <spot/tl/parse.hh>
 #include <spot/twa/formula2bdd.hh>
 #include <spot/twa/twagraph.hh>
 #include <iostream>
+#include <list>
 #include <map>
+#include <memory>
 #include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 unsigned get_max_u_disj_size(spot::formula f);
 
@@ -42,4 +48,27 @@ SLAA* make_alternating(spot::formula f, spot::bdd_dict_ptr dict = nullptr);
 // helper function for LTL to automata translation
 unsigned make_alternating_recursive(SLAA* slaa, spot::formula f);
 
+// a translated subformula that can be copied to another SLAA (-C flag)
+// it contains all states the subformula depends on, with states
+// and acceptance marks numbered locally
+typedef struct {
+	bdd label;
+	id_set targets;
+	id_set marks;
+} fragment_edge;
+
+typedef struct {
+	// states[0] is the subformula itself
+	std::vector<spot::formula> states;
+	std::vector<std::vector<fragment_edge>> edges;
+	std::map<spot::formula, SLAA::acc_phi> acc;
+	std::set<acc_mark> inf_marks;
+	std::vector<std::pair<unsigned, unsigned>> dom_states;
+	// APs in the order of their registration
+	std::vector<spot::formula> aps;
+} slaa_fragment;
+
+// releases all cached SLAA fragments
+void clear_slaa_fragment_cache();
+
 #endif
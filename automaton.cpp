@@ -18,10 +18,13 @@
 */
 
 #include "automaton.hpp"
+#include "telemetry.hpp"
 
 template class Automaton<spot::formula>;
 template class Automaton<unsigned>;
 
+unsigned long product_edge_count = 0;
+
 // Print handler for bdd_allsat
 // Taken from LTL3BA source: https://sourceforge.net/projects/ltl3ba/
 bool print_or = false;
@@ -55,15 +58,15 @@ void allsatPrintHandler(char* varset, int size) {
 }
 
 template<typename T> unsigned Automaton<T>::get_state_id(T f) {
-	unsigned size = states.size();
-	for (unsigned i = 0; i < size; ++i) {
-		if (states[i] == f) {
-			return i;
-		}
+	auto id_it = state_ids.find(f);
+	if (id_it != state_ids.end()) {
+		return id_it->second;
 	}
 
+	unsigned size = states.size();
 	states.push_back(f);
 	state_edges.push_back(std::set<unsigned>());
+	state_ids.insert(std::make_pair(f, size));
 	return size;
 }
 
@@ -72,21 +75,60 @@ template<typename T> T Automaton<T>::state_name(unsigned state_id) {
 }
 
 template<typename T> bool Automaton<T>::state_exists(T f) {
-	return find(states.begin(), states.end(), f) != states.end();
+	return state_ids.count(f) > 0;
 }
 
 template<typename T> unsigned Automaton<T>::states_count() {
 	return states.size();
 }
 
+template<typename T> unsigned Automaton<T>::edges_count() {
+	unsigned count = 0;
+	for (auto& es : state_edges) {
+		count += es.size();
+	}
+	return count;
+}
+
 template<typename T> unsigned Automaton<T>::create_edge(bdd label) {
-	auto e = new Edge(label);
-	edges.push_back(e);
+	if (!free_edges.empty()) {
+		unsigned edge_id = free_edges.back();
+		free_edges.pop_back();
+		edges[edge_id] = Edge(label);
+
+		return edge_id;
+	}
+
+	edges.emplace_back(label);
 
 	return edges.size() - 1;
 }
 
-template<typename T> void Automaton<T>::add_edge(unsigned from, bdd label, std::set<unsigned> to, std::set<acc_mark> marks) {
+template<typename T> void Automaton<T>::release_edge(unsigned edge_id) {
+	// drop the BDD reference and the target and mark sets
+	edges[edge_id] = Edge(bddfalse);
+	if (hold_released_edges) {
+		held_edges.push_back(edge_id);
+	} else {
+		free_edges.push_back(edge_id);
+	}
+}
+
+template<typename T> void Automaton<T>::release_edges(const std::set<unsigned>& edge_ids) {
+	for (auto edge_id : edge_ids) {
+		release_edge(edge_id);
+	}
+}
+
+template<typename T> void Automaton<T>::hold_edge_release(bool hold) {
+	hold_released_edges = hold;
+	if (!hold) {
+		free_edges.insert(free_edges.end(), held_edges.begin(), held_edges.end());
+		held_edges.clear();
+	}
+}
+
+template<typename T> void Automaton<T>::add_edge(unsigned from, bdd label, id_set to, id_set marks) {
 	if (label == bddfalse) {
 		return;
 	}
@@ -102,30 +144,36 @@ template<typename T> void Automaton<T>::add_edge(unsigned from, bdd label, std::
 	// we always do this for NA
 	if (o_slaa_determ || spot_id_to_slaa_set != nullptr) {
 		std::set<unsigned> edges_to_add;
-		// we look at all other edges and check if the new edge dominates the other
-		// NOP in the increment part as we sometimes increment the iterator with erase
-		for (auto e_other_it = state_edges[from].begin(); e_other_it != state_edges[from].end(); /* NOP */) {
-			auto e_other = get_edge(*e_other_it);
-
-			int dom_level;
-			if (spot_id_to_slaa_set == nullptr) {
-				dom_level = e_this->dominates(e_other, get_inf_marks());
-			} else {
-				dom_level = e_this->dominates(e_other,
-					(*spot_id_to_slaa_set)[state_name(*(e_this->get_targets().begin()))],
-					(*spot_id_to_slaa_set)[state_name(*(e_other->get_targets().begin()))],
-					get_inf_marks()
-				);
+		// the signatures let us skip most of the pairs that cannot dominate each other
+		uint64_t this_signature = domination_target_signature(e_this);
+		// we look at the other edges that the new edge may dominate
+		for (auto e_other_id : domination_candidates(from, this_signature, true)) {
+			auto e_other = get_edge(e_other_id);
+
+			int dom_level = 0;
+			if (may_dominate(e_this, this_signature, e_other, domination_target_signature(e_other))) {
+				if (spot_id_to_slaa_set == nullptr) {
+					dom_level = e_this->dominates(e_other, inf_marks);
+				} else {
+					dom_level = e_this->dominates(e_other,
+						(*spot_id_to_slaa_set)[state_name(*(e_this->get_targets().begin()))],
+						(*spot_id_to_slaa_set)[state_name(*(e_other->get_targets().begin()))],
+						inf_marks
+					);
+				}
 			}
 			switch (dom_level) {
 				case 1:
 					// we are adding an edge that is equal in its targets and mark sets to e_other
 					// remove e_other and add an edge labeled a1 | a2
 					e_this->set_label(e_this->get_label() | e_other->get_label());
-					state_edges[from].erase(e_other_it);
+					remove_edge(from, e_other_id);
+					release_edge(e_other_id);
 					add_edge(from, edge_id);
+					release_edge(edge_id);
 
 					add_edge(from, edges_to_add);
+					release_edges(edges_to_add);
 					return;
 				case 2: {
 					// we relabel each dominating edge
@@ -139,31 +187,35 @@ template<typename T> void Automaton<T>::add_edge(unsigned from, bdd label, std::
 				}
 				// no break
 				case 3:
-					e_other_it = state_edges[from].erase(e_other_it);
+					// e_other is not referenced anywhere else
+					remove_edge(from, e_other_id);
+					release_edge(e_other_id);
 				break;
-				default:
-					++e_other_it;
 			}
 		}
 
 		// now we check if there exists some other edge that dominates our edge
-		for (auto& e_other_id : state_edges[from]) {
+		for (auto e_other_id : domination_candidates(from, this_signature, false)) {
 			auto e_other = get_edge(e_other_id);
-			int dom_level;
-			if (spot_id_to_slaa_set == nullptr) {
-				dom_level = e_other->dominates(e_this, get_inf_marks());
-			} else {
-				dom_level = e_other->dominates(e_this,
-					(*spot_id_to_slaa_set)[state_name(*(e_other->get_targets().begin()))],
-					(*spot_id_to_slaa_set)[state_name(*(e_this->get_targets().begin()))],
-					get_inf_marks()
-				);
+			int dom_level = 0;
+			if (may_dominate(e_other, domination_target_signature(e_other), e_this, this_signature)) {
+				if (spot_id_to_slaa_set == nullptr) {
+					dom_level = e_other->dominates(e_this, inf_marks);
+				} else {
+					dom_level = e_other->dominates(e_this,
+						(*spot_id_to_slaa_set)[state_name(*(e_other->get_targets().begin()))],
+						(*spot_id_to_slaa_set)[state_name(*(e_this->get_targets().begin()))],
+						inf_marks
+					);
+				}
 			}
 			switch (dom_level) {
 				case 3:
 					// do not add
 					// the new edge is killed by the existing edge
+					release_edge(edge_id);
 					add_edge(from, edges_to_add);
+					release_edges(edges_to_add);
 					return;
 				case 2:
 					// relabel the new edge
@@ -173,14 +225,16 @@ template<typename T> void Automaton<T>::add_edge(unsigned from, bdd label, std::
 		}
 
 		add_edge(from, edges_to_add);
+		release_edges(edges_to_add);
 	}
 
 	state_edges[from].insert(edge_id);
+	index_edge(from, edge_id);
 }
 
 template<typename T> void Automaton<T>::add_edge(unsigned from, unsigned edge_id) {
-	auto orig = edges[edge_id];
-	add_edge(from, orig->get_label(), orig->get_targets(), orig->get_marks());
+	const Edge& orig = edges[edge_id];
+	add_edge(from, orig.get_label(), orig.get_targets(), orig.get_marks());
 }
 
 template<typename T> void Automaton<T>::add_edge(unsigned from, std::set<unsigned> edge_ids) {
@@ -189,20 +243,181 @@ template<typename T> void Automaton<T>::add_edge(unsigned from, std::set<unsigne
 	}
 }
 
+template<typename T> void Automaton<T>::add_edge_unchecked(unsigned from, bdd label, const id_set& to, const id_set& marks) {
+	unsigned edge_id = create_edge(label);
+
+	Edge* e = get_edge(edge_id);
+	e->add_target(to);
+	e->add_mark(marks);
+
+	state_edges[from].insert(edge_id);
+	index_edge(from, edge_id);
+}
+
 template<typename T> void Automaton<T>::remove_edge(unsigned state_id, unsigned edge_id) {
-	state_edges[state_id].erase(edge_id);
+	if (state_edges[state_id].erase(edge_id) > 0) {
+		unindex_edge(state_id, edge_id);
+	}
+}
+
+template<typename T> bool Automaton<T>::has_edge(unsigned state_id, unsigned edge_id) const {
+	return state_edges[state_id].count(edge_id) > 0;
 }
 
-template<typename T> std::set<acc_mark> Automaton<T>::get_inf_marks() const {
+template<typename T> const std::set<acc_mark>& Automaton<T>::get_inf_marks() const {
 	return inf_marks;
 }
 
 template<typename T> void Automaton<T>::remember_inf_mark(acc_mark mark) {
 	inf_marks.insert(mark);
+	inf_marks_signature = set_signature(inf_marks);
 }
 
 template<typename T> void Automaton<T>::remember_inf_mark(std::set<acc_mark> marks) {
 	inf_marks.insert(marks.begin(), marks.end());
+	inf_marks_signature = set_signature(inf_marks);
+}
+
+template<typename T> uint64_t Automaton<T>::domination_target_signature(Edge* e) {
+	if (spot_id_to_slaa_set == nullptr) {
+		return e->get_target_signature();
+	}
+
+	// for NA, the domination compares SLAA sets of the target states
+	unsigned spot_id = state_name(*(e->get_targets().begin()));
+	if (slaa_set_signatures.size() <= spot_id) {
+		slaa_set_signatures.resize(std::max<size_t>(spot_id_to_slaa_set->size(), spot_id + 1), 0);
+	}
+	// the signature of a nonempty set is never 0; the ∅ state is cheap to recompute
+	if (slaa_set_signatures[spot_id] == 0) {
+		slaa_set_signatures[spot_id] = set_signature((*spot_id_to_slaa_set)[spot_id]);
+	}
+
+	return slaa_set_signatures[spot_id];
+}
+
+template<typename T> void Automaton<T>::build_domination_index(unsigned state_id) {
+	if (domination_index_valid.size() < states.size()) {
+		domination_index.resize(states.size());
+		domination_index_valid.resize(states.size(), false);
+	}
+
+	if (domination_index_valid[state_id]) {
+		return;
+	}
+
+	domination_index[state_id].clear();
+	domination_index_valid[state_id] = true;
+	for (auto edge_id : state_edges[state_id]) {
+		index_edge(state_id, edge_id);
+	}
+}
+
+template<typename T> void Automaton<T>::index_edge(unsigned state_id, unsigned edge_id) {
+	if (state_id >= domination_index_valid.size() || !domination_index_valid[state_id]) {
+		return;
+	}
+
+	auto& buckets = domination_index[state_id];
+	uint64_t sig = domination_target_signature(get_edge(edge_id));
+	if (sig == 0) {
+		buckets[64].push_back(edge_id);
+	}
+	for (; sig != 0; sig &= sig - 1) {
+		buckets[__builtin_ctzll(sig)].push_back(edge_id);
+	}
+}
+
+template<typename T> void Automaton<T>::unindex_edge(unsigned state_id, unsigned edge_id) {
+	if (state_id >= domination_index_valid.size() || !domination_index_valid[state_id]) {
+		return;
+	}
+
+	// the signature is the same as when the edge was indexed, the index
+	// is invalidated whenever the targets could change
+	auto& buckets = domination_index[state_id];
+	auto unindex_from = [&buckets, edge_id](unsigned bit) {
+		auto& bucket = buckets[bit];
+		auto it = std::find(bucket.begin(), bucket.end(), edge_id);
+		if (it != bucket.end()) {
+			*it = bucket.back();
+			bucket.pop_back();
+		}
+	};
+
+	uint64_t sig = domination_target_signature(get_edge(edge_id));
+	if (sig == 0) {
+		unindex_from(64);
+	}
+	for (; sig != 0; sig &= sig - 1) {
+		unindex_from(__builtin_ctzll(sig));
+	}
+}
+
+template<typename T> void Automaton<T>::invalidate_domination_index() {
+	domination_index.clear();
+	domination_index_valid.clear();
+}
+
+template<typename T> std::vector<unsigned> Automaton<T>::domination_candidates(unsigned state_id, uint64_t sig, bool superset) {
+	build_domination_index(state_id);
+	auto& buckets = domination_index[state_id];
+
+	std::vector<unsigned> candidates;
+	if (superset) {
+		if (sig == 0) {
+			return std::vector<unsigned>(state_edges[state_id].begin(), state_edges[state_id].end());
+		}
+
+		// a candidate is in the bucket of each bit of sig, so the smallest one is enough
+		const std::vector<unsigned>* smallest = nullptr;
+		for (uint64_t rest = sig; rest != 0; rest &= rest - 1) {
+			auto it = buckets.find(__builtin_ctzll(rest));
+			if (it == buckets.end() || it->second.empty()) {
+				return candidates;
+			}
+			if (smallest == nullptr || it->second.size() < smallest->size()) {
+				smallest = &it->second;
+			}
+		}
+		candidates = *smallest;
+	} else {
+		// a candidate has no bit outside sig, so it is in the bucket
+		// of the empty signature or in the bucket of some bit of sig
+		auto collect = [&](unsigned bit) {
+			auto it = buckets.find(bit);
+			if (it != buckets.end()) {
+				for (auto edge_id : it->second) {
+					if ((domination_target_signature(get_edge(edge_id)) & ~sig) == 0) {
+						candidates.push_back(edge_id);
+					}
+				}
+			}
+		};
+
+		collect(64);
+		for (uint64_t rest = sig; rest != 0; rest &= rest - 1) {
+			collect(__builtin_ctzll(rest));
+		}
+	}
+
+	// keep the order of a scan over the edges of the state
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+	return candidates;
+}
+
+template<typename T> bool Automaton<T>::may_dominate(Edge* e1, uint64_t o1, Edge* e2, uint64_t o2) const {
+	// O1 ⊆ O2 is needed
+	if ((o1 & ~o2) != 0) {
+		return false;
+	}
+
+	// each not-Inf mark in J1 has to be in J2; the marks whose bits
+	// are not shared with any Inf-mark are surely not Inf-marks
+	uint64_t j1 = e1->get_mark_signature();
+	uint64_t j2 = e2->get_mark_signature();
+	return (j1 & ~inf_marks_signature & ~j2) == 0;
 }
 
 std::set<std::set<unsigned>> SLAA::get_init_sets() const {
@@ -222,7 +437,7 @@ void NA::set_init_state(unsigned s) {
 }
 
 template<typename T> Edge* Automaton<T>::get_edge(unsigned edge_id) const {
-	return edges[edge_id];
+	return const_cast<Edge*>(&edges[edge_id]);
 }
 
 template<typename T> std::set<unsigned> Automaton<T>::get_state_edges(unsigned state_id) const {
@@ -230,22 +445,39 @@ template<typename T> std::set<unsigned> Automaton<T>::get_state_edges(unsigned s
 	return state_edges[state_id];
 }
 
-template<typename T> unsigned Automaton<T>::edge_product(unsigned e1, unsigned e2, bool preserve_ixsets) {
-	auto e = new Edge(edges[e1]->get_label() & edges[e2]->get_label());
-	edges.push_back(e);
-	e->add_target(edges[e1]->get_targets());
-	e->add_target(edges[e2]->get_targets());
+template<typename T> unsigned Automaton<T>::edge_product(unsigned e1, unsigned e2, bool preserve_mark_sets) {
+	unsigned edge_id = create_edge(edges[e1].get_label() & edges[e2].get_label());
+	++product_edge_count;
+	Edge& e = edges[edge_id];
+	e.add_target(edges[e1].get_targets());
+	e.add_target(edges[e2].get_targets());
 
-	if (preserve_ixsets) {
-		e->add_mark(edges[e1]->get_marks());
-		e->add_mark(edges[e2]->get_marks());
+	if (preserve_mark_sets) {
+		e.add_mark(edges[e1].get_marks());
+		e.add_mark(edges[e2].get_marks());
 	}
 
-	return edges.size() - 1;
+	return edge_id;
+}
+
+// returns the product of two sets of edges; false products are never created
+template<typename T> std::set<unsigned> Automaton<T>::product_step(const std::set<unsigned>& s0, const std::set<unsigned>& s1, bool preserve_mark_sets) {
+	std::set<unsigned> result;
+
+	for (auto& e0 : s0) {
+		bdd l0 = edges[e0].get_label();
+		for (auto& e1 : s1) {
+			if ((l0 & edges[e1].get_label()) != bddfalse) {
+				result.insert(edge_product(e0, e1, preserve_mark_sets));
+			}
+		}
+	}
+
+	return result;
 }
 
 // returns a set of edges in the product
-template<typename T> std::set<unsigned> Automaton<T>::product(std::set<std::set<unsigned>> edges_sets, bool preserve_ixsets) {
+template<typename T> std::set<unsigned> Automaton<T>::product(const std::set<std::set<unsigned>>& edges_sets, bool preserve_mark_sets) {
 	if (edges_sets.empty()) {
 		// this is not a correct value for product of empty set
 		// in NA, a ∅ state is true and should contain a loop
@@ -254,28 +486,72 @@ template<typename T> std::set<unsigned> Automaton<T>::product(std::set<std::set<
 		return std::set<unsigned>();
 	}
 
-	auto s0 = *(edges_sets.begin());
-
-	if (edges_sets.size() == 1) {
-		return s0;
+	// multiply the smallest sets first to keep the partial products small
+	std::vector<const std::set<unsigned>*> factors;
+	for (auto& s : edges_sets) {
+		factors.push_back(&s);
+	}
+	std::stable_sort(factors.begin(), factors.end(), [](const std::set<unsigned>* a, const std::set<unsigned>* b) {
+		return a->size() < b->size();
+	});
+
+	std::set<unsigned> result = *factors[0];
+	for (unsigned i = 1; i < factors.size() && !result.empty(); ++i) {
+		auto next = product_step(result, *factors[i], preserve_mark_sets);
+		// partial products (but not the first factor) are fresh edges
+		if (i > 1) {
+			release_edges(result);
+		}
+		result = std::move(next);
 	}
 
-	edges_sets.erase(edges_sets.begin());
-	auto s1 = product(edges_sets, preserve_ixsets);
+	return result;
+}
 
-	std::set<unsigned> result;
+// the number of memoised product edges above which `state_product' drops them
+const unsigned max_product_cache_edges = 1 << 18;
 
-	for (auto& e0 : s0) {
-		for (auto& e1 : s1) {
+template<typename T> const std::set<unsigned>& Automaton<T>::state_product(const std::set<unsigned>& state_ids, bool preserve_mark_sets) {
+	static const std::set<unsigned> empty_product;
+	if (state_ids.empty()) {
+		return empty_product;
+	}
 
-			unsigned p = edge_product(e0, e1, preserve_ixsets);
-			if (get_edge(p)->get_label() != bdd_false()) {
-				result.insert(p);
-			}
+	// the prefixes are kept for the sets of states explored later; once they
+	// take too much memory, start over instead of keeping all of them
+	if (product_cache_edges > max_product_cache_edges) {
+		clear_product_cache();
+	}
+
+	// order the states by the number of their edges; the order has to be
+	// deterministic so that prefixes shared by different sets of states match
+	std::vector<unsigned> order(state_ids.begin(), state_ids.end());
+	std::stable_sort(order.begin(), order.end(), [this](unsigned a, unsigned b) {
+		return state_edges[a].size() < state_edges[b].size();
+	});
+
+	const std::set<unsigned>* result = &state_edges[order[0]];
+	std::pair<bool, std::vector<unsigned>> key = { preserve_mark_sets, { order[0] } };
+	for (unsigned i = 1; i < order.size(); ++i) {
+		key.second.push_back(order[i]);
+
+		auto it = product_cache.find(key);
+		if (it == product_cache.end()) {
+			it = product_cache.emplace(key, product_step(*result, state_edges[order[i]], preserve_mark_sets)).first;
+			product_cache_edges += it->second.size();
 		}
+		result = &it->second;
 	}
 
-	return result;
+	return *result;
+}
+
+template<typename T> void Automaton<T>::clear_product_cache() {
+	for (auto& kv : product_cache) {
+		release_edges(kv.second);
+	}
+	product_cache.clear();
+	product_cache_edges = 0;
 }
 
 void SLAA::build_acc() {
@@ -336,6 +612,9 @@ std::set<std::set<acc_mark>> SLAA::get_minimal_models_of_acc_cond() const {
 }
 
 void SLAA::apply_extended_domination() {
+	// the edges are erased below without updating the dominance index
+	invalidate_domination_index();
+
 	const auto& mm = get_minimal_models_of_acc_cond();
 	for (unsigned state_id = 0, states_count = states.size(); state_id < states_count; ++state_id) {
 		for (auto e1_id : state_edges[state_id]) {
@@ -349,11 +628,11 @@ void SLAA::apply_extended_domination() {
 
 				auto e2 = get_edge(*e2_it);
 
-				auto o1 = e1->get_targets();
-				auto o2 = e2->get_targets();
+				const auto& o1 = e1->get_targets();
+				const auto& o2 = e2->get_targets();
 
-				auto j1 = e1->get_marks();
-				auto j2 = e2->get_marks();
+				const auto& j1 = e1->get_marks();
+				const auto& j2 = e2->get_marks();
 
 				// e1 dominates e2 iff
 				// 1. e1.targets ⊆ e2.targets
@@ -361,7 +640,7 @@ void SLAA::apply_extended_domination() {
 				// 2a. M ∩ Fin(Φ) ∩ e2.marks = ∅ => M ∩ Fin(Φ) ∩ e1.marks = ∅
 				// 2b. M ∩ Inf(Φ) ∩ e1.marks = ∅ => M ∩ Inf(Φ) ∩ e2.marks = ∅
 				bool dominates = false;
-				if (std::includes(std::begin(o2), std::end(o2), std::begin(o1), std::end(o1))) { // condition (1) holds
+				if (o2.includes(o1)) { // condition (1) holds
 					const auto& inf_marks = get_inf_marks();
 
 					dominates = true; // we may rewrite this again later
@@ -423,6 +702,9 @@ spot::formula SLAA::get_input_formula() const {
 }
 
 template<typename T> void Automaton<T>::remove_unreachable_states() {
+	// the SLAA and the NA report different phases
+	phase_telemetry telemetry(std::is_same<T, unsigned>::value ? "na_remove_unreachable_states" : "slaa_remove_unreachable_states");
+
 	std::map<unsigned, unsigned> conversion_table;
 	std::queue<unsigned> bfs_queue;
 	unsigned reachable_state_ct = 0;
@@ -452,8 +734,8 @@ template<typename T> void Automaton<T>::remove_unreachable_states() {
 
 		for (auto& edge_id : get_state_edges(state_id)) {
 			auto edge = get_edge(edge_id);
-			auto targets = edge->get_targets();
-			std::set<unsigned> new_target_set;
+			const auto& targets = edge->get_targets();
+			id_set new_target_set;
 			for (auto& target_id : targets) {
 				unsigned new_target_id;
 				if (conversion_table.count(target_id) == 0) {
@@ -486,10 +768,19 @@ template<typename T> void Automaton<T>::remove_unreachable_states() {
 
 	states = new_state_table;
 	state_edges = new_state_edges_table;
+	invalidate_domination_index();
+
+	// rebuild the index of state names
+	state_ids.clear();
+	for (unsigned i = 0; i < conv_table_size; ++i) {
+		state_ids.insert(std::make_pair(states[i], i));
+	}
+
+	telemetry.count("states", conv_table_size);
 }
 
-void SLAA::add_edge(unsigned from, bdd label, std::set<unsigned> to, std::set<acc_mark> marks) {
-	std::set<unsigned> to_(to);
+void SLAA::add_edge(unsigned from, bdd label, id_set to, id_set marks) {
+	id_set to_(to);
 	for (auto& kv : dom_states) {
 		if (to_.find(kv.first) != std::end(to_)) {
 			for (auto& s : kv.second) {
@@ -501,8 +792,8 @@ void SLAA::add_edge(unsigned from, bdd label, std::set<unsigned> to, std::set<ac
 }
 
 void SLAA::add_edge(unsigned from, unsigned edge_id) {
-	auto orig = edges[edge_id];
-	add_edge(from, orig->get_label(), orig->get_targets(), orig->get_marks());
+	const Edge& orig = edges[edge_id];
+	add_edge(from, orig.get_label(), orig.get_targets(), orig.get_marks());
 }
 
 void SLAA::add_edge(unsigned from, std::set<unsigned> edge_ids) {
@@ -686,6 +977,10 @@ void SLAA::register_dom_states(unsigned strong, unsigned weak, unsigned option_l
 	}
 }
 
+const std::map<unsigned, std::set<unsigned>>& SLAA::get_dom_states() const {
+	return dom_states;
+}
+
 void SLAA::print_hoaf() {
 	bool sink_state_needed = false;
 	bool true_state_exists = false;
@@ -754,7 +1049,7 @@ void SLAA::print_hoaf() {
 		std::cout << "State: " << state_id << " \"" << spot::unabbreviate(simp.simplify(states[state_id]), "WM") << "\"\n";
 		// for every edge of this state
 		for (auto& edge_id : state_edges[state_id]) {
-			Edge* edge = edges[edge_id];
+			const Edge* edge = &edges[edge_id];
 
 			std::cout << "  [";
 			print_or = false;
@@ -762,7 +1057,7 @@ void SLAA::print_hoaf() {
 			std::cout << "] ";
 
 			bool target_printed = false;
-			auto targets = edge->get_targets();
+			const auto& targets = edge->get_targets();
 
 			for (auto& target_id : targets) {
 				if (target_printed) {
@@ -777,7 +1072,7 @@ void SLAA::print_hoaf() {
 				std::cout << sink_state_id;
 			}
 
-			auto marks = edge->get_marks();
+			const auto& marks = edge->get_marks();
 			if (!marks.empty()) {
 				std::cout << " {";
 				bool mark_printed = false;
@@ -854,8 +1149,8 @@ void SLAA::print_dot() {
 		for (auto& edge_id : edges) {
 			auto edge = get_edge(edge_id);
 
-			auto targets = edge->get_targets();
-			auto marks = edge->get_marks();
+			const auto& targets = edge->get_targets();
+			const auto& marks = edge->get_marks();
 
 			unsigned targets_count = targets.size();
 
@@ -930,74 +1225,48 @@ NA::NA(std::vector<std::set<unsigned>>* sets) {
 // the resulting label is disjunction of labels
 // and mark set is union of mark sets
 void NA::merge_edges() {
-	// set of edges IDs that are removed and we should ignore them
-	std::set<unsigned> removed_edges;
-
 	for (unsigned state_id = 0, states_no = states_count(); state_id < states_no; ++state_id) {
-		auto state_edges = get_state_edges(state_id);
-		std::vector<unsigned> edges_list(state_edges.begin(), state_edges.end());
+		std::vector<unsigned> edges_list(state_edges[state_id].begin(), state_edges[state_id].end());
 
-		for (unsigned i = 0; i < edges_list.size(); ++i) {
-			auto e1_id = edges_list[i];
+		// edges with equal target and acceptance labels are joined
+		// the first edge of each group absorbs the labels of the others
+		std::vector<unsigned> kept_edges;
+		std::map<std::pair<unsigned, id_set>, unsigned> by_target_and_marks;
+		for (auto edge_id : edges_list) {
+			auto edge = get_edge(edge_id);
+			auto key = std::make_pair(*(edge->get_targets().begin()), edge->get_marks());
 
-			if (removed_edges.count(e1_id) > 0) {
-				// this is not valid anymore
-				continue;
+			auto it = by_target_and_marks.emplace(std::move(key), edge_id);
+			if (it.second) {
+				kept_edges.push_back(edge_id);
+			} else {
+				auto e1 = get_edge(it.first->second);
+				e1->set_label(e1->get_label() | edge->get_label());
+				remove_edge(state_id, edge_id);
+				release_edge(edge_id);
 			}
+		}
 
-			auto e1 = get_edge(e1_id);
-
-			for (unsigned j = i + 1; j < edges_list.size(); ++j) {
-				auto e2_id = edges_list[j];
-
-				if (removed_edges.count(e2_id) > 0) {
-					// this is not valid anymore
-					continue;
-				}
+		// edges with equal target and transition label whose marks are all Inf
+		// can be joined too, with the union of their marks
+		std::map<std::pair<unsigned, int>, unsigned> by_target_and_label;
+		for (auto edge_id : kept_edges) {
+			auto edge = get_edge(edge_id);
+			const auto& marks = edge->get_marks();
 
-				auto e2 = get_edge(e2_id);
-
-				auto j1 = e1->get_marks();
-				auto j2 = e2->get_marks();
-
-				auto l1 = e1->get_label();
-				auto l2 = e2->get_label();
-
-				if (e1->get_targets() == e2->get_targets()) {
-					// target sets are equal
-					if (j1 == j2) {
-						// acceptance labels too; join these edges
-						e1->set_label(e1->get_label() | e2->get_label());
-						removed_edges.insert(e2_id);
-						remove_edge(state_id, e2_id);
-					} else if (l1 == l2) {
-						// are all marks from J1 and J2 Inf marks?
-						bool merge_fail = false;
-
-						for (auto mark : j1) {
-							if (inf_marks.count(mark) == 0) {
-								merge_fail = true;
-								break;
-							}
-						}
-						if (!merge_fail) {
-							for (auto mark : j2) {
-								if (inf_marks.count(mark) == 0) {
-									merge_fail = true;
-									break;
-								}
-							}
-						}
+			bool only_inf = std::all_of(marks.begin(), marks.end(), [this](acc_mark mark) {
+				return inf_marks.count(mark) > 0;
+			});
+			if (!only_inf) {
+				continue;
+			}
 
-						if (!merge_fail) {
-							// join these edges
-							e1->add_mark(j2);
-							e1->set_label(l1 | l2);
-							removed_edges.insert(e2_id);
-							remove_edge(state_id, e2_id);
-						}
-					}
-				}
+			auto key = std::make_pair(*(edge->get_targets().begin()), edge->get_label().id());
+			auto it = by_target_and_label.emplace(key, edge_id);
+			if (!it.second) {
+				get_edge(it.first->second)->add_mark(marks);
+				remove_edge(state_id, edge_id);
+				release_edge(edge_id);
 			}
 		}
 	}
@@ -1006,8 +1275,38 @@ void NA::merge_edges() {
 void NA::merge_equivalent_states() {
 	unsigned states_size = states_count();
 
+	// the edges entering each state, so that merging a state retargets only them
+	std::vector<std::vector<unsigned>> entering(states_size);
+	for (unsigned s = 0; s < states_size; ++s) {
+		for (auto& edge_id : state_edges[s]) {
+			entering[*(get_edge(edge_id)->get_targets().begin())].push_back(edge_id);
+		}
+	}
+
+	// equivalent states have the same multiset of (label, marks) on their edges
+	// this does not change by merging, so the states are bucketed by it once
+	std::map<std::vector<std::pair<int, id_set>>, std::vector<unsigned>> buckets;
+	std::vector<const std::vector<unsigned>*> bucket_of(states_size);
+	for (unsigned s = 0; s < states_size; ++s) {
+		std::vector<std::pair<int, id_set>> signature;
+		for (auto& edge_id : state_edges[s]) {
+			auto edge = get_edge(edge_id);
+			signature.emplace_back(edge->get_label().id(), edge->get_marks());
+		}
+		std::sort(signature.begin(), signature.end());
+
+		auto& bucket = buckets[signature];
+		bucket.push_back(s);
+		bucket_of[s] = &bucket;
+	}
+
+	// one pass over the pairs s1 < s2 in the same order as comparing all pairs,
+	// skipping the pairs from different buckets that cannot be equivalent
 	for (unsigned s1 = 0; s1 < states_size; ++s1) {
-		for (unsigned s2 = s1 + 1; s2 < states_size; ++s2) {
+		const auto& bucket = *bucket_of[s1];
+		for (auto it = std::upper_bound(bucket.begin(), bucket.end(), s1); it != bucket.end(); ++it) {
+			unsigned s2 = *it;
+
 			// first try the basic check δ(q1) = δ(q2)
 			bool st_equiv = states_equivalent(s1, s2, 1);
 
@@ -1018,15 +1317,11 @@ void NA::merge_equivalent_states() {
 
 			if (st_equiv) {
 				// retarget each s2-transition to s1
-				for (unsigned state_id = 0; state_id < states_size; ++state_id) {
-					for (auto& edge_id : get_state_edges(state_id)) {
-						auto edge = get_edge(edge_id);
-
-						if (*(edge->get_targets().begin()) == s2) {
-							edge->replace_target_set(std::set<unsigned>({ s1 }));
-						}
-					}
+				for (auto edge_id : entering[s2]) {
+					get_edge(edge_id)->replace_target_set(id_set({ s1 }));
 				}
+				entering[s1].insert(entering[s1].end(), entering[s2].begin(), entering[s2].end());
+				entering[s2].clear();
 
 				// if s2 was an initial state, s1 is the new one
 				if (get_init_state() == s2) {
@@ -1035,11 +1330,12 @@ void NA::merge_equivalent_states() {
 			}
 		}
 	}
+	invalidate_domination_index();
 }
 
 bool NA::states_equivalent(unsigned s1, unsigned s2, unsigned eq_level) {
-	auto s1_edges = get_state_edges(s1);
-	auto s2_edges = get_state_edges(s2);
+	const auto& s1_edges = state_edges[s1];
+	const auto& s2_edges = state_edges[s2];
 
 	// do the edges sets have equal size?
 	if (s1_edges.size() != s2_edges.size()) {
@@ -1096,13 +1392,6 @@ bool NA::states_equivalent(unsigned s1, unsigned s2, unsigned eq_level) {
 	return true;
 }
 
-template<typename T> Automaton<T>::~Automaton() {
-	for (auto e : edges) {
-		delete e;
-	}
-	edges.clear();
-}
-
 Edge::Edge(bdd l) {
 	set_label(l);
 }
@@ -1117,48 +1406,57 @@ void Edge::set_label(bdd l) {
 
 void Edge::add_target(unsigned state_id) {
 	targets.insert(state_id);
+	target_signature |= set_signature(std::initializer_list<unsigned>({ state_id }));
 }
 
-void Edge::add_target(std::set<unsigned> state_ids) {
-	targets.insert(state_ids.begin(), state_ids.end());
+void Edge::add_target(const id_set& state_ids) {
+	targets.unite(state_ids);
+	target_signature |= set_signature(state_ids);
 }
 
 void Edge::remove_target(unsigned state_id) {
-	auto target_it = targets.find(state_id);
-	if (target_it != targets.end()) {
-		targets.erase(target_it);
-	}
+	targets.erase(state_id);
+	target_signature = set_signature(targets);
 }
 
-void Edge::replace_target_set(std::set<unsigned> state_ids) {
-	targets.clear();
-	add_target(state_ids);
+void Edge::replace_target_set(const id_set& state_ids) {
+	targets = state_ids;
+	target_signature = set_signature(targets);
 }
 
 void Edge::add_mark(unsigned ix) {
 	marks.insert(ix);
+	mark_signature |= set_signature(std::initializer_list<unsigned>({ ix }));
 }
 
-void Edge::add_mark(std::set<unsigned> ixs) {
-	marks.insert(ixs.begin(), ixs.end());
+void Edge::add_mark(const id_set& ixs) {
+	marks.unite(ixs);
+	mark_signature |= set_signature(ixs);
 }
 
 void Edge::remove_mark(unsigned ix) {
-	auto mark_it = marks.find(ix);
-	if (mark_it != marks.end()) {
-		marks.erase(mark_it);
-	}
+	marks.erase(ix);
+	mark_signature = set_signature(marks);
 }
 
 void Edge::clear_marks() {
 	marks.clear();
+	mark_signature = 0;
+}
+
+uint64_t Edge::get_target_signature() const {
+	return target_signature;
+}
+
+uint64_t Edge::get_mark_signature() const {
+	return mark_signature;
 }
 
-std::set<unsigned> Edge::get_targets() const {
+const id_set& Edge::get_targets() const {
 	return targets;
 }
 
-std::set<unsigned> Edge::get_marks() const {
+const id_set& Edge::get_marks() const {
 	return marks;
 }
 
@@ -1169,15 +1467,15 @@ std::set<unsigned> Edge::get_marks() const {
 //   else returns 2
 // else returns 0
 // where edge 1 is this edge and edge 2 is the other edge
-int Edge::dominates(Edge* other, std::set<acc_mark> inf_marks) const {
-	auto o1 = get_targets();
-	auto j1 = get_marks();
+int Edge::dominates(Edge* other, const std::set<acc_mark>& inf_marks) const {
+	const auto& o1 = get_targets();
+	const auto& j1 = get_marks();
 
-	auto o2 = other->get_targets();
-	auto j2 = other->get_marks();
+	const auto& o2 = other->get_targets();
+	const auto& j2 = other->get_marks();
 
 	// now check if O1 ⊆ O2 & J1 ⊆ J2
-	if (!std::includes(o2.begin(), o2.end(), o1.begin(), o1.end())) {
+	if (!o2.includes(o1)) {
 		return 0;
 	}
 
@@ -1204,10 +1502,10 @@ int Edge::dominates(Edge* other, std::set<acc_mark> inf_marks) const {
 	}
 }
 
-int Edge::dominates(Edge* other, std::set<unsigned> o1, std::set<unsigned> o2, std::set<acc_mark> inf_marks) const {
+int Edge::dominates(Edge* other, const std::set<unsigned>& o1, const std::set<unsigned>& o2, const std::set<acc_mark>& inf_marks) const {
 	// t1 kills t2 if O1 ⊆ O2 & a2 => a1
-	auto j1 = get_marks();
-	auto j2 = other->get_marks();
+	const auto& j1 = get_marks();
+	const auto& j2 = other->get_marks();
 
 	if (std::includes(o2.begin(), o2.end(), o1.begin(), o1.end())
 		&& (other->get_label() & bdd_not(get_label())) == bdd_false()
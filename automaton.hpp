@@ -20,10 +20,17 @@
 #ifndef AUTOMATON_H
 #define AUTOMATON_H
 #include <algorithm>
+#include <deque>
 #include <map>
 #include <stack>
+#include <initializer_list>
+#include <iterator>
+#include <set>
 #include <string>
 #include <sstream>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <spot/tl/print.hh>
 #include <queue>
 #include <vector>
@@ -41,32 +48,229 @@
 
 typedef unsigned acc_mark;
 
+// the number of edges created by edge_product so far (for the telemetry)
+extern unsigned long product_edge_count;
+
+// a set of states or acceptance marks stored as a sorted array
+// up to inline_capacity values are stored inside the object without
+// any allocation; the set operations work on contiguous memory
+class id_set {
+	static const unsigned inline_capacity = 4;
+
+	unsigned n = 0;
+	bool on_heap = false;
+	unsigned small[inline_capacity] = {};
+	std::vector<unsigned> large;
+
+	unsigned* data() {
+		return on_heap ? large.data() : small;
+	}
+
+	// moves the values to the heap storage
+	void spill() {
+		large.assign(small, small + n);
+		on_heap = true;
+	}
+
+public:
+	typedef unsigned value_type;
+	typedef const unsigned* const_iterator;
+	typedef const_iterator iterator;
+
+	id_set() {}
+
+	id_set(std::initializer_list<unsigned> values) {
+		for (auto v : values) {
+			insert(v);
+		}
+	}
+
+	// std::set is already sorted, so its values are just copied
+	id_set(const std::set<unsigned>& values) {
+		if (values.size() > inline_capacity) {
+			large.assign(values.begin(), values.end());
+			on_heap = true;
+		} else {
+			std::copy(values.begin(), values.end(), small);
+		}
+		n = values.size();
+	}
+
+	template<typename It> id_set(It first, It last) {
+		insert(first, last);
+	}
+
+	const_iterator begin() const {
+		return on_heap ? large.data() : small;
+	}
+
+	const_iterator end() const {
+		return begin() + n;
+	}
+
+	unsigned size() const {
+		return n;
+	}
+
+	bool empty() const {
+		return n == 0;
+	}
+
+	const_iterator find(unsigned v) const {
+		auto it = std::lower_bound(begin(), end(), v);
+		return (it != end() && *it == v) ? it : end();
+	}
+
+	unsigned count(unsigned v) const {
+		return find(v) != end() ? 1 : 0;
+	}
+
+	void insert(unsigned v) {
+		unsigned pos = std::lower_bound(begin(), end(), v) - begin();
+		if (pos < n && begin()[pos] == v) {
+			return;
+		}
+
+		if (!on_heap && n == inline_capacity) {
+			spill();
+		}
+
+		if (on_heap) {
+			large.insert(large.begin() + pos, v);
+		} else {
+			std::copy_backward(small + pos, small + n, small + n + 1);
+			small[pos] = v;
+		}
+		++n;
+	}
+
+	template<typename It> void insert(It first, It last) {
+		for (; first != last; ++first) {
+			insert(*first);
+		}
+	}
+
+	unsigned erase(unsigned v) {
+		auto it = find(v);
+		if (it == end()) {
+			return 0;
+		}
+		erase(it);
+		return 1;
+	}
+
+	void erase(const_iterator it) {
+		unsigned pos = it - begin();
+		if (on_heap) {
+			large.erase(large.begin() + pos);
+		} else {
+			std::copy(small + pos + 1, small + n, small + pos);
+		}
+		--n;
+	}
+
+	void clear() {
+		n = 0;
+		on_heap = false;
+		large.clear();
+	}
+
+	// this ∪= other
+	void unite(const id_set& other) {
+		if (other.n == 0) {
+			return;
+		}
+
+		if (n + other.n <= inline_capacity && !on_heap) {
+			unsigned merged[2 * inline_capacity];
+			auto merged_end = std::set_union(begin(), end(), other.begin(), other.end(), merged);
+			n = merged_end - merged;
+			std::copy(merged, merged_end, small);
+		} else {
+			std::vector<unsigned> merged;
+			merged.reserve(n + other.n);
+			std::set_union(begin(), end(), other.begin(), other.end(), std::back_inserter(merged));
+			large.swap(merged);
+			on_heap = true;
+			n = large.size();
+		}
+	}
+
+	// returns true if other ⊆ this
+	bool includes(const id_set& other) const {
+		return other.n <= n && std::includes(begin(), end(), other.begin(), other.end());
+	}
+
+	// returns true if this ∩ other ≠ ∅
+	bool intersects(const id_set& other) const {
+		auto i1 = begin(), e1 = end();
+		auto i2 = other.begin(), e2 = other.end();
+		while (i1 != e1 && i2 != e2) {
+			if (*i1 < *i2) {
+				++i1;
+			} else if (*i2 < *i1) {
+				++i2;
+			} else {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// returns this ∩ other
+	id_set intersection(const id_set& other) const {
+		id_set r;
+		for (auto v : *this) {
+			if (other.count(v) > 0) {
+				r.insert(v);
+			}
+		}
+		return r;
+	}
+
+	bool operator==(const id_set& other) const {
+		return n == other.n && std::equal(begin(), end(), other.begin());
+	}
+
+	bool operator!=(const id_set& other) const {
+		return !(*this == other);
+	}
+
+	bool operator<(const id_set& other) const {
+		return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+	}
+};
+
 class Edge {
 protected:
 	// target set of the edge
-	std::set<unsigned> targets;
+	id_set targets;
 
 	// the acceptance label
-	std::set<acc_mark> marks;
+	id_set marks;
 
 	// the transition labels in BDD
 	bdd label;
+
+	// Bloom signatures of targets and marks, kept in sync with the sets
+	uint64_t target_signature = 0;
+	uint64_t mark_signature = 0;
 public:
 	Edge(bdd l);
 
 	// adds a state or a set of states to the target set
 	void add_target(unsigned state_id);
-	void add_target(std::set<unsigned> state_ids);
+	void add_target(const id_set& state_ids);
 
 	// removes a state from the target set
 	void remove_target(unsigned state_id);
 
 	// replaces the target set with given set
-	void replace_target_set(std::set<unsigned> state_ids);
+	void replace_target_set(const id_set& state_ids);
 
 	// adds an acceptance mark or a set of them
 	void add_mark(unsigned ix);
-	void add_mark(std::set<unsigned> ixs);
+	void add_mark(const id_set& ixs);
 
 	// removes an acceptance mark
 	void remove_mark(unsigned ix);
@@ -75,10 +279,14 @@ public:
 	void clear_marks();
 
 	// returns the target set
-	std::set<unsigned> get_targets() const;
+	const id_set& get_targets() const;
 
 	// returns the acceptance label
-	std::set<unsigned> get_marks() const;
+	const id_set& get_marks() const;
+
+	// returns the signatures of the target set and the acceptance label
+	uint64_t get_target_signature() const;
+	uint64_t get_mark_signature() const;
 
 	// returns the transition label
 	bdd get_label() const;
@@ -86,8 +294,8 @@ public:
 	// sets the transition label
 	void set_label(bdd l);
 
-	int dominates(Edge* other, std::set<unsigned> o1, std::set<unsigned> o2, std::set<acc_mark> inf_marks) const;
-	int dominates(Edge* other, std::set<acc_mark> inf_marks) const;
+	int dominates(Edge* other, const std::set<unsigned>& o1, const std::set<unsigned>& o2, const std::set<acc_mark>& inf_marks) const;
+	int dominates(Edge* other, const std::set<acc_mark>& inf_marks) const;
 };
 
 template<typename T> class Automaton {
@@ -95,8 +303,27 @@ protected:
 	// vector of names of states
 	std::vector<T> states;
 
-	// vector of edges
-	std::vector<Edge*> edges;
+	// index of states by their names, kept consistent with `states'
+	std::unordered_map<T, unsigned> state_ids;
+
+	// storage of edges; a deque keeps the addresses of edges stable
+	std::deque<Edge> edges;
+
+	// IDs of released edges whose slots can be reused by `create_edge'
+	std::vector<unsigned> free_edges;
+	// IDs of edges released while `hold_released_edges' is set
+	std::vector<unsigned> held_edges;
+	bool hold_released_edges = false;
+
+	// products of edges of states computed by `state_product', indexed by
+	// the mark preservation flag and the ordered prefix of states
+	// the cache owns the edges it stores
+	std::map<std::pair<bool, std::vector<unsigned>>, std::set<unsigned>> product_cache;
+	// the number of edges stored in product_cache
+	unsigned product_cache_edges = 0;
+
+	// returns the product of two sets of edges, skipping the false ones
+	std::set<unsigned> product_step(const std::set<unsigned>& s0, const std::set<unsigned>& s1, bool preserve_mark_sets);
 
 	// state_edges maps a set of edges to each state
 	std::vector<std::set<unsigned>> state_edges;
@@ -106,6 +333,43 @@ protected:
 	// a set of Inf-marks used in the automaton
 	std::set<acc_mark> inf_marks;
 
+	// the signature of `inf_marks'
+	uint64_t inf_marks_signature = 0;
+
+	// signatures of the sets in `spot_id_to_slaa_set', computed on demand
+	std::vector<uint64_t> slaa_set_signatures;
+
+	// returns the signature of the target set used for the domination of the edge
+	uint64_t domination_target_signature(Edge* e);
+
+	// returns false if the edge e1 with targets' signature o1 surely does not
+	// dominate the edge e2 with targets' signature o2; cheaper than Edge::dominates
+	bool may_dominate(Edge* e1, uint64_t o1, Edge* e2, uint64_t o2) const;
+
+	// for each state, its edges bucketed by the bits of their domination target
+	// signatures (bucket 64 holds the edges with the empty signature)
+	// a state's index is built by the first add_edge that needs it and kept
+	// in sync by add_edge, add_edge_unchecked and remove_edge
+	std::vector<std::map<unsigned, std::vector<unsigned>>> domination_index;
+	std::vector<bool> domination_index_valid;
+
+	// builds the index of the state if it is not valid
+	void build_domination_index(unsigned state_id);
+
+	// adds the edge to or removes it from a valid index of the state
+	void index_edge(unsigned state_id, unsigned edge_id);
+	void unindex_edge(unsigned state_id, unsigned edge_id);
+
+	// drops the indices of all states; to be called when the edges of states
+	// are changed in place or the states are renumbered
+	void invalidate_domination_index();
+
+	// returns the edges of the state whose domination target signatures include
+	// sig (if superset holds) or are included in sig, in increasing order of IDs
+	// these are the only edges that may be dominated by or dominate an edge
+	// with the signature sig
+	std::vector<unsigned> domination_candidates(unsigned state_id, uint64_t sig, bool superset);
+
 	// the set of initial configurations
 	std::set<std::set<unsigned>> init_sets;
 
@@ -122,11 +386,24 @@ public:
 	// returns the number of states
 	unsigned states_count();
 
+	// returns the number of edges leaving the states
+	unsigned edges_count();
+
 	// creates an edge and returns its ID (index in the `edges' set)
 	unsigned create_edge(bdd label);
 
+	// marks the given edge as dead so that its slot can be reused
+	// the edge must not be referenced by any state
+	void release_edge(unsigned edge_id);
+	void release_edges(const std::set<unsigned>& edge_ids);
+
+	// while hold is set, the released edges are not reused, so an ID of an edge
+	// released in the meantime never refers to another edge
+	// unsetting hold makes the held slots reusable
+	void hold_edge_release(bool hold);
+
 	// creates an edge with given source state, labels and target set
-	void add_edge(unsigned from, bdd label, std::set<unsigned> to, std::set<acc_mark> marks = std::set<acc_mark>());
+	void add_edge(unsigned from, bdd label, id_set to, id_set marks = id_set());
 
 	// copies the given edge to the source `from'
 	void add_edge(unsigned from, unsigned edge_id);
@@ -134,9 +411,17 @@ public:
 	// copies the given edges to the source `from'
 	void add_edge(unsigned from, std::set<unsigned> edge_ids);
 
+	// creates an edge without any domination checks
+	// to be used for edges that are known to be reduced already
+	void add_edge_unchecked(unsigned from, bdd label, const id_set& to, const id_set& marks);
+
 	// removes the given edge from the source
 	void remove_edge(unsigned state_id, unsigned edge_id);
 
+	// checks whether the edge still leaves the state; add_edge releases
+	// the edges of the state that the added edge dominates
+	bool has_edge(unsigned state_id, unsigned edge_id) const;
+
 	// returns a pointer to the edge specified by ID
 	Edge* get_edge(unsigned edge_id) const;
 
@@ -144,7 +429,7 @@ public:
 	std::set<unsigned> get_state_edges(unsigned state_id) const;
 
 	// returns the registered Inf-marks
-	std::set<acc_mark> get_inf_marks() const;
+	const std::set<acc_mark>& get_inf_marks() const;
 
 	// registers the marks in the set `inf_marks'
 	void remember_inf_mark(acc_mark mark);
@@ -158,9 +443,18 @@ public:
 
 	// for the family of sets { M_1, ..., M_n } of edges,
 	// returns set of products of each n edges from distinct M_i
-	std::set<unsigned> product(std::set<std::set<unsigned>> edges_sets, bool preserve_mark_sets);
-
-	~Automaton();
+	// the returned edges are fresh (and may be released) unless `edges_sets' has a single element
+	std::set<unsigned> product(const std::set<std::set<unsigned>>& edges_sets, bool preserve_mark_sets);
+
+	// returns the product of edges of the given states
+	// the result is memoised and owned by the automaton until the next call of
+	// `state_product' or `clear_product_cache', as the memoised products are
+	// dropped once they hold too many edges; the states' edges must not change
+	// in the meantime
+	const std::set<unsigned>& state_product(const std::set<unsigned>& state_ids, bool preserve_mark_sets);
+
+	// releases all memoised products
+	void clear_product_cache();
 };
 
 class SLAA : public Automaton<spot::formula> {
@@ -195,7 +489,7 @@ public:
 	std::map<spot::formula, acc_phi> acc;
 
 	// creates an edge with given source state, labels and target set
-	void add_edge(unsigned from, bdd label, std::set<unsigned> to, std::set<acc_mark> marks = std::set<acc_mark>());
+	void add_edge(unsigned from, bdd label, id_set to, id_set marks = id_set());
 
 	// copies the given edge to the source `from'
 	void add_edge(unsigned from, unsigned edge_id);
@@ -228,6 +522,9 @@ public:
 	// register a pair of dominating and dominated states
 	void register_dom_states(unsigned strong, unsigned weak, unsigned option_level);
 
+	// returns the registered pairs of dominating and dominated states
+	const std::map<unsigned, std::set<unsigned>>& get_dom_states() const;
+
 	// prints the automaton in HOA format
 	void print_hoaf();
 
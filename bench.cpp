@@ -0,0 +1,332 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmark of the translation stages on the formulae in Experiments
+// usage: ./bench [-w warmup] [-r repetitions] [-o baseline] [-c baseline]
+//                [-t percent] [formula files] [-- ltl3tela flags]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <glob.h>
+#include "alternating.hpp"
+#include "nondeterministic.hpp"
+#include "spotela.hpp"
+#include "translator.hpp"
+#include "utils.hpp"
+
+// the measured stages, in the order of the translation
+const std::vector<std::string> stages = { "simplify_formula", "make_alternating", "make_nondeterministic", "spotela_simplify" };
+
+// the statistics of one stage over the formula suite, in milliseconds
+typedef struct {
+	double total;
+	double p50;
+	double p90;
+	double p99;
+	double max;
+} stage_stats;
+
+typedef std::chrono::steady_clock bench_clock;
+
+double elapsed_ms(bench_clock::time_point since) {
+	return std::chrono::duration<double, std::milli>(bench_clock::now() - since).count();
+}
+
+// translates f once, storing the time of each stage to times
+// returns false if the translation failed (e.g. exceeded a budget)
+bool run_pipeline(spot::formula f, spot::bdd_dict_ptr dict, std::vector<double>& times) {
+	try {
+		start_candidate_budget();
+
+		auto start = bench_clock::now();
+		auto g = simplify_formula(f);
+		times[0] = elapsed_ms(start);
+
+		start = bench_clock::now();
+		std::unique_ptr<SLAA> slaa(make_alternating(g, dict));
+		slaa->remove_unreachable_states();
+		slaa->remove_unnecessary_marks();
+		times[1] = elapsed_ms(start);
+
+		start = bench_clock::now();
+		auto nwa = make_nondeterministic(slaa.get());
+		times[2] = elapsed_ms(start);
+		slaa.reset();
+
+		start = bench_clock::now();
+		spotela_simplify(nwa);
+		times[3] = elapsed_ms(start);
+	} catch (std::runtime_error&) {
+		return false;
+	}
+
+	return true;
+}
+
+// returns the value at the given percentile (nearest rank) of sorted values
+double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+
+	unsigned rank = std::ceil(p / 100 * sorted.size());
+	return sorted[std::max(rank, 1u) - 1];
+}
+
+double median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+std::vector<std::string> default_formula_files() {
+	std::vector<std::string> files;
+	glob_t g;
+
+	if (glob("Experiments/formulae/*.ltl", 0, nullptr, &g) == 0) {
+		files.assign(g.gl_pathv, g.gl_pathv + g.gl_pathc);
+	}
+	globfree(&g);
+
+	return files;
+}
+
+// reads the formulae of the given files, one per line
+std::vector<spot::formula> load_formulae(const std::vector<std::string>& files) {
+	std::vector<spot::formula> formulae;
+
+	for (auto& file_name : files) {
+		std::ifstream file(file_name);
+		if (!file) {
+			std::cerr << "Unable to open " << file_name << ", skipping it.\n";
+			continue;
+		}
+
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.find_first_not_of(" \t\r") == std::string::npos) {
+				continue;
+			}
+
+			try {
+				formulae.push_back(spot::parse_formula(line));
+			} catch (spot::parse_error&) {
+				std::cerr << "Skipping the invalid formula " << line << '\n';
+			}
+		}
+	}
+
+	return formulae;
+}
+
+// reads a baseline written by print_stats
+std::map<std::string, stage_stats> load_baseline(const std::string& file_name) {
+	std::map<std::string, stage_stats> baseline;
+	std::ifstream file(file_name);
+	std::string line;
+
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		std::istringstream in(line);
+		std::string stage;
+		stage_stats s;
+		if (in >> stage >> s.total >> s.p50 >> s.p90 >> s.p99 >> s.max) {
+			baseline[stage] = s;
+		}
+	}
+
+	return baseline;
+}
+
+void print_stats(std::ostream& out, const std::map<std::string, stage_stats>& stats) {
+	out << "# stage total_ms p50_ms p90_ms p99_ms max_ms\n" << std::fixed << std::setprecision(3);
+	for (auto& stage : stages) {
+		auto& s = stats.at(stage);
+		out << stage << ' ' << s.total << ' ' << s.p50 << ' ' << s.p90 << ' ' << s.p99 << ' ' << s.max << '\n';
+	}
+}
+
+int main(int argc, char* argv[]) {
+	unsigned warmup = 1;
+	unsigned repetitions = 5;
+	double threshold = 10;
+	std::string baseline_out;
+	std::string baseline_in;
+	std::vector<std::string> files;
+	// the arguments passed to parse_arguments, argv[0] first
+	std::vector<char*> translation_args = { argv[0] };
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg(argv[i]);
+
+		if (arg == "--") {
+			translation_args.insert(translation_args.end(), argv + i + 1, argv + argc);
+			break;
+		} else if ((arg == "-w" || arg == "-r" || arg == "-o" || arg == "-c" || arg == "-t") && i + 1 < argc) {
+			std::string value(argv[++i]);
+			if (arg == "-w") {
+				warmup = std::stoi(value);
+			} else if (arg == "-r") {
+				repetitions = std::max(std::stoi(value), 1);
+			} else if (arg == "-o") {
+				baseline_out = value;
+			} else if (arg == "-c") {
+				baseline_in = value;
+			} else {
+				threshold = std::stod(value);
+			}
+		} else if (arg[0] == '-') {
+			std::cerr << "Usage: " << argv[0] << " [-w warmup] [-r repetitions] [-o baseline] [-c baseline] [-t percent] [formula files] [-- ltl3tela flags]\n";
+			return 2;
+		} else {
+			files.push_back(arg);
+		}
+	}
+
+	// parse_arguments fills in the defaults only if some flag is given
+	char default_flag[] = "-x0";
+	if (translation_args.size() == 1) {
+		translation_args.push_back(default_flag);
+	}
+
+	auto args = parse_arguments(translation_args.size(), translation_args.data());
+	if (args.empty()) {
+		std::cerr << "Invalid ltl3tela flags, see ./ltl3tela -h.\n";
+		return 2;
+	}
+	set_options(args);
+
+	int bdd_status = bdd_init(std::stoi(args["M"]), std::stoi(args["Q"]));
+	if (bdd_status < 0) {
+		std::cerr << "Unable to initialize the BDD library: " << bdd_errstring(bdd_status) << ".\n";
+		return 2;
+	}
+	bdd_setmaxincrease(std::stoi(args["R"]));
+	bdd_gbc_hook(count_bdd_gc);
+
+	auto dict = spot::make_bdd_dict();
+
+	if (files.empty()) {
+		files = default_formula_files();
+	}
+	auto formulae = load_formulae(files);
+
+	// times[stage][formula] holds the time of each repetition
+	std::vector<std::vector<std::vector<double>>> times(stages.size(), std::vector<std::vector<double>>(formulae.size()));
+	std::vector<bool> failed(formulae.size(), false);
+	std::vector<double> run_times(stages.size());
+
+	for (unsigned rep = 0; rep < warmup + repetitions; ++rep) {
+		// each repetition starts with the same state of the SLAA cache (-C)
+		clear_slaa_fragment_cache();
+
+		for (unsigned i = 0; i < formulae.size(); ++i) {
+			if (failed[i]) {
+				continue;
+			}
+
+			if (!run_pipeline(formulae[i], dict, run_times)) {
+				failed[i] = true;
+				continue;
+			}
+
+			if (rep >= warmup) {
+				for (unsigned s = 0; s < stages.size(); ++s) {
+					times[s][i].push_back(run_times[s]);
+				}
+			}
+		}
+	}
+
+	clear_slaa_fragment_cache();
+
+	// a formula is represented by the median of its repetitions
+	std::map<std::string, stage_stats> stats;
+	for (unsigned s = 0; s < stages.size(); ++s) {
+		std::vector<double> medians;
+		for (unsigned i = 0; i < formulae.size(); ++i) {
+			if (!failed[i]) {
+				medians.push_back(median(times[s][i]));
+			}
+		}
+		std::sort(medians.begin(), medians.end());
+
+		stage_stats st;
+		st.total = 0;
+		for (auto m : medians) {
+			st.total += m;
+		}
+		st.p50 = percentile(medians, 50);
+		st.p90 = percentile(medians, 90);
+		st.p99 = percentile(medians, 99);
+		st.max = medians.empty() ? 0 : medians.back();
+		stats[stages[s]] = st;
+	}
+
+	unsigned failures = std::count(failed.begin(), failed.end(), true);
+	std::cout << "# " << formulae.size() - failures << " formulae (" << failures << " failed), "
+		<< warmup << " warmup and " << repetitions << " measured repetitions\n";
+	print_stats(std::cout, stats);
+	std::cout << "# BDD GC: " << bdd_gc_count << " runs, " << bdd_gc_seconds << " s\n";
+
+	if (!baseline_out.empty()) {
+		std::ofstream out(baseline_out);
+		print_stats(out, stats);
+		if (!out) {
+			std::cerr << "Unable to write the baseline " << baseline_out << ".\n";
+			return 2;
+		}
+	}
+
+	if (baseline_in.empty()) {
+		return 0;
+	}
+
+	// compare the totals with the baseline
+	auto baseline = load_baseline(baseline_in);
+	bool regressed = false;
+
+	for (auto& stage : stages) {
+		if (baseline.count(stage) == 0 || baseline[stage].total <= 0) {
+			std::cout << stage << ": not in the baseline\n";
+			continue;
+		}
+
+		double change = (stats[stage].total / baseline[stage].total - 1) * 100;
+		std::cout << stage << ": " << std::showpos << change << std::noshowpos << " %";
+		if (change > threshold) {
+			std::cout << " REGRESSION";
+			regressed = true;
+		}
+		std::cout << '\n';
+	}
+
+	return regressed ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <spot/misc/version.hh>
+#include <spot/tl/print.hh>
+#include "cache.hpp"
+
+// the Makefile sets the build identifier to a checksum of the sources,
+// so that the entries of an older build are never reused
+#ifndef LTL3TELA_BUILD_ID
+#define LTL3TELA_BUILD_ID __DATE__ " " __TIME__
+#endif
+
+// 64-bit FNV-1a hash
+uint64_t fnv1a_hash(const std::string& s) {
+	uint64_t h = 14695981039346656037ULL;
+	for (unsigned char c : s) {
+		h ^= c;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+std::string result_cache_key(spot::formula f, const std::map<std::string, std::string>& args, const std::string& version) {
+	std::ostringstream key;
+	key << "LTL3TELA " << version << " build " << LTL3TELA_BUILD_ID << " Spot " << spot::version() << ';';
+
+	// options that do not change the output of a translation
+	std::set<std::string> ignored_options = { "f", "I", "j", "K" };
+
+	for (auto& arg : args) {
+		if (ignored_options.count(arg.first) == 0) {
+			key << arg.first << '=' << arg.second << ';';
+		}
+	}
+
+	// the prediction table of -H changes the output with its contents
+	auto table = args.find("H");
+	if (table != args.end()) {
+		std::ifstream in(table->second, std::ios::binary);
+		std::ostringstream contents;
+		contents << in.rdbuf();
+		key << "H#" << fnv1a_hash(contents.str()) << ';';
+	}
+
+	key << spot::str_psl(f);
+	return key.str();
+}
+
+// returns the name of the file for the key in the cache directory
+// the names are 64-bit FNV-1a hashes; the file contains the full key
+// so that a collision is detected
+std::string cache_file_name(const std::string& dir, const std::string& key) {
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)fnv1a_hash(key));
+	return dir + "/" + name;
+}
+
+// reads a string of the form "<length>\n<contents>"
+bool read_sized_string(std::istream& in, std::string& s) {
+	size_t size;
+	if (!(in >> size) || in.get() != '\n') {
+		return false;
+	}
+
+	s.resize(size);
+	return size == 0 || in.read(&s[0], size);
+}
+
+bool load_cached_result(const std::string& dir, const std::string& key, task_result& result) {
+	std::ifstream in(cache_file_name(dir, key), std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	std::string stored_key;
+	if (!read_sized_string(in, stored_key) || stored_key != key) {
+		return false;
+	}
+
+	task_result r;
+	if (!(in >> r.exit_code) || in.get() != '\n' || !read_sized_string(in, r.out) || !read_sized_string(in, r.err)) {
+		return false;
+	}
+
+	result = r;
+	return true;
+}
+
+void store_cached_result(const std::string& dir, const std::string& key, const task_result& result) {
+	// create the directory if needed; if it exists, this harmlessly fails
+	mkdir(dir.c_str(), 0777);
+
+	std::string file_name = cache_file_name(dir, key);
+	// the temporary file is private to this process
+	std::string tmp_name = file_name + "." + std::to_string(getpid()) + ".tmp";
+
+	{
+		std::ofstream out(tmp_name, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			return;
+		}
+
+		out << key.size() << '\n' << key;
+		out << result.exit_code << '\n';
+		out << result.out.size() << '\n' << result.out;
+		out << result.err.size() << '\n' << result.err;
+
+		out.close();
+		if (!out) {
+			std::remove(tmp_name.c_str());
+			return;
+		}
+	}
+
+	// rename() replaces the file atomically
+	if (std::rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+		std::remove(tmp_name.c_str());
+	}
+}
@@ -0,0 +1,42 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CACHE_H
+#define CACHE_H
+#include <map>
+#include <string>
+#include <spot/tl/formula.hh>
+#include "parallel.hpp"
+
+// returns the key identifying the translation of the formula f as parsed
+// (not simplified, as some candidates are built from the formula itself)
+// with the given command-line options (and the contents of the -H table)
+// by the given version and build of LTL3TELA
+std::string result_cache_key(spot::formula f, const std::map<std::string, std::string>& args, const std::string& version);
+
+// looks up the result stored under the key in the cache directory dir
+// returns false if there is none
+bool load_cached_result(const std::string& dir, const std::string& key, task_result& result);
+
+// stores the result under the key in the cache directory dir;
+// the file is replaced atomically, so concurrent readers never see a partial one
+// failures are ignored, the cache is only an optimization
+void store_cached_result(const std::string& dir, const std::string& key, const task_result& result);
+
+#endif
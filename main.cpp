@@ -17,6 +17,7 @@
     along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <fstream>
 #include <iostream>
 #include <spot/misc/version.hh>
 #include <spot/twaalgos/dot.hh>
@@ -27,34 +28,117 @@
 #include "nondeterministic.hpp"
 #include "automaton.hpp"
 #include "spotela.hpp"
+#include "parallel.hpp"
+#include "cache.hpp"
+#include "telemetry.hpp"
+#include "translator.hpp"
 
-unsigned o_try_ltl2tgba_spotela;	// -b
-unsigned o_slaa_trans_red;	// -c
-bool o_single_init_state;	// -i
-unsigned o_slaa_determ;		// -d
-unsigned o_eq_level;		// -e
-bool o_ltl_split;			// -l
-unsigned o_mergeable_info;	// -m
-bool o_try_negation;		// -n
-bool o_simplify_formula;	// -s
-bool o_ac_filter_fin;		// -t
-unsigned o_debug;			// -x
-
-bool o_deterministic;		// -D
-
-unsigned o_u_merge_level;	// -F
-unsigned o_g_merge_level;	// -G
-bool o_disj_merging;		// -O
-bool o_x_single_succ;		// -X
+const std::string version("2.1.1");
 
-int main(int argc, char* argv[])
-{
-	std::string version("2.1.1");
+// translates a parsed formula and prints the resulting automata to STDOUT
+// returns the exit code of the translation (0 on success)
+int translate_formula(spot::formula f, std::map<std::string, std::string>& args, spot::bdd_dict_ptr dict, unsigned print_phase) {
+	spot::twa_graph_ptr nwa = nullptr;
+	SLAA* slaa = nullptr;
+	std::string stats("");
+
+	set_telemetry_formula(f);
+
+	auto gc_count = bdd_gc_count;
+	auto gc_seconds = bdd_gc_seconds;
+
+	try {
+		std::tie(nwa, slaa, stats) = build_best_nwa(f, dict, print_phase & 1, print_phase == 1);
+
+		f = simplify_formula(f);
+
+		if (o_ltl_split) {
+			spot::twa_graph_ptr nwa_prod;
+			std::string stats_prod;
+
+			std::tie(nwa_prod, stats_prod) = build_product_nwa(f, dict);
+			std::tie(nwa, stats) = compare_automata(nwa, nwa_prod, stats, stats_prod);
+		}
+	} catch (std::runtime_error& e) {
+		std::string what(e.what());
+
+		if (what.find("Too many acceptance sets used.") == 0) {
+			std::cerr << "LTL3TELA is unable to set more than 32 acceptance marks.\n";
+			return 32;
+		} else {
+			std::cerr << what << std::endl;
+			return 3;
+		}
+	}
+
+	if (slaa) {
+		if (args["o"] == "dot") {
+			slaa->print_dot();
+		} else {
+			slaa->print_hoaf();
+		}
+
+		delete slaa;
+	}
+
+	if (nwa) {
+		if (args["o"] == "dot") {
+			spot::print_dot(std::cout, nwa);
+		} else {
+			spot::print_hoa(std::cout, nwa);
+			std::cout << '\n';
+		}
+	}
+
+	if (o_debug & 1) {
+		std::cerr << stats;
+		std::cerr << "BDD GC: " << bdd_gc_count - gc_count << " runs, " << bdd_gc_seconds - gc_seconds << " s\n";
+	}
+
+	return 0;
+}
+
+// translates one formula and prints the resulting automata to STDOUT
+// with -K, the output is looked up in and stored to the cache directory
+// (unless -x1 or -x4 is given)
+// returns the exit code of the translation (0 on success)
+int translate_and_print(const std::string& input, std::map<std::string, std::string>& args, spot::bdd_dict_ptr dict, unsigned print_phase) {
+	spot::formula f;
+	try {
+		f = spot::parse_formula(input);
+	} catch (spot::parse_error& e) {
+		std::cerr << "The input formula is invalid.\n" << e.what();
+		return 1;
+	}
+
+	// the statistics of -x1 and -x4 contain times measured by this run,
+	// a cached copy of them would be stale
+	if (args.count("K") == 0 || (o_debug & 5)) {
+		return translate_formula(f, args, dict, print_phase);
+	}
+
+	std::string key = result_cache_key(f, args, version);
+	task_result r;
 
-	bdd_init(1000, 1000);
-	// hide "garbage collection" messages from BuDDy
-	bdd_gbc_hook(nullptr);
+	if (!load_cached_result(args["K"], key, r)) {
+		r = capture_output([&]() {
+			return translate_formula(f, args, dict, print_phase);
+		});
 
+		// failures may be caused by the environment, do not remember them
+		if (r.exit_code == 0) {
+			store_cached_result(args["K"], key, r);
+		}
+	}
+
+	std::cout << r.out;
+	std::cerr << r.err;
+
+	return r.exit_code;
+}
+
+int main(int argc, char* argv[])
+{
 	std::map<std::string, std::string> args = parse_arguments(argc, argv);
 
 	if (args.count("v") > 0) {
@@ -62,26 +146,31 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
-	bool invalid_run = args.count("f") == 0;
+	// exactly one of -f and -I has to be given
+	bool invalid_run = (args.count("f") > 0) == (args.count("I") > 0);
 
 	if (invalid_run || args.count("h") > 0) {
 		std::cout << "LTL3TELA " << version << " (using Spot " << spot::version() << ")\n\n"
 			<< "usage: " << argv[0] << " [-flags] -f formula\n"
+			<< "       " << argv[0] << " [-flags] -I file\n"
 			<< "available flags:\n"
 			<< "\t-a[0|2|3]\tact like\n"
 			<< "\t\t0\tdo not simulate anything (default)\n"
 			<< "\t\t2\tltl2ba (like -d0 -n0 -e1)\n"
 			<< "\t\t3\tltl3ba (like -n0 -i1 -X1)\n"
+			<< "\t-A[0|1]\tgive the atomic propositions used together neighbouring BDD variables (default off)\n"
 			<< "\t-b[0|1|2|3]\tproduce TGBA if smaller\n"
 			<< "\t\t0\tno action\n"
 			<< "\t\t1\ttry ltl2tgba\n"
 			<< "\t\t2\ttry SPOTELA\n"
 			<< "\t\t3\ttry ltl2tgba+SPOTELA (default)\n"
+			<< "\t-B N\tgive up an LTL3TELA candidate using more than N BDD nodes (default 0 = no limit)\n"
 			<< "\t-c[0|1|2|3]\tSLAA transition reduction\n"
 			<< "\t\t0\tno reductions\n"
 			<< "\t\t1\ton U-merging\n"
 			<< "\t\t2\ton G-merging\n"
 			<< "\t\t3\ton both U- and G-merging (default)\n"
+			<< "\t-C[0|1]\treuse SLAA parts of subformulae across translations (default off)\n"
 			<< "\t-d\tmore deterministic SLAA construction\n"
 			<< "\t\t0\tno optimization\n"
 			<< "\t\t1\tclassical transition dominance\n"
@@ -101,21 +190,33 @@ int main(int argc, char* argv[])
 			<< "\t\t1\tmerge Gf if f is temporal formula\n"
 			<< "\t\t2\tmerge Gf is f is conjunction of temporal formulae (default)\n"
 			<< "\t-h, -?\tprint this help\n"
+			<< "\t-H file\twith -z, predict the candidates from the results in CSV file\n"
 			<< "\t-i[0|1]\tproduce SLAA with one initial state (default off)\n"
+			<< "\t-I file\ttranslate each line of file as a formula (- for STDIN)\n"
+			<< "\t-j N\twith -I, translate the formulae in N worker processes (default 1)\n"
+			<< "\t-k[0|1]\tdrop the automaton for !f once it has more states than the one for f (default off)\n"
+			<< "\t-K dir\treuse the results stored in the cache directory dir\n"
+			<< "\t-L[0|1]\tcheck the NA against the one built on the fly (for testing, default off)\n"
+			<< "\t-M N\tinitial size of the BDD node table (default 1000)\n"
 			<< "\t-m\t(for experiments only) check formula for containment of\n"
 			<< "\t\t0\tnothing, translate formula as usual (default)\n"
 			<< "\t\t1\tmergeable F\n"
 			<< "\t\t2\tmergeable G\n"
+			<< "\t-N N\tgive up an LTL3TELA candidate with more than N states (default 0 = no limit)\n"
 			<< "\t-n[0|1]\ttry translating !f and complementing the automaton (default on)\n"
 			<< "\t-o [hoa|dot]\ttype of output\n"
 			<< "\t\thoa\tprint automaton in HOA format (default)\n"
 			<< "\t\tdot\tprint dot format\n"
 			<< "\t-O[0|1]\tdisjunction merging (default off)\n"
+			<< "\t-P[0|1]\trun the candidate translations in parallel processes (default off)\n"
 			<< "\t-p[1|2|3]\tphase of translation\n"
 			<< "\t\t1\tprint SLAA\n"
 			<< "\t\t2\tprint NA (default)\n"
 			<< "\t\t3\tprint both\n"
+			<< "\t-Q N\tsize of the BDD operation cache (default 1000)\n"
+			<< "\t-R N\tgrow the BDD node table by at most N nodes at once, 0 = no limit (default 50000)\n"
 			<< "\t-s[0|1]\tspot's formula simplifications (default on)\n"
+			<< "\t-T ms\tgive up an LTL3TELA candidate after ms milliseconds (default 0 = no limit)\n"
 			<< "\t-t[0|1]\timproved construction of acceptance condition (default on)\n"
 			<< "\t-v\tprint version and exit\n"
 			<< "\t-x\t(for experiments only) special experiments-related options\n"
@@ -123,105 +224,119 @@ int main(int argc, char* argv[])
 			<< "\t\t1\tstatistics to STDERR\n"
 			<< "\t\t2\tuse only external translator, not LTL3TELA algorithm\n"
 			<< "\t\t3\tboth -x1 and -x2\n"
-			<< "\t-X[0|1]\ttranslate X phi as (X phi) --tt--> (phi) (default off)\n";
+			<< "\t\t4\tper-phase measurements as JSON lines to STDERR (adds to the above)\n"
+			<< "\t-X[0|1]\ttranslate X phi as (X phi) --tt--> (phi) (default off)\n"
+			<< "\t-z[0|1|2]\tpredict from the formula which candidate translations to run\n"
+			<< "\t\t0\trun all the candidates (default)\n"
+			<< "\t\t1\trun only the predicted ones\n"
+			<< "\t\t2\trun only the predicted ones if the prediction is clear, otherwise all\n";
 
 		return invalid_run;
 	}
 
-	spot::formula f;
-	try {
-		f = spot::parse_formula(args["f"]);
-	} catch (spot::parse_error& e) {
-		std::cerr << "The input formula is invalid.\n" << e.what();
-		return 1;
-	}
-
-	o_try_ltl2tgba_spotela = std::stoi(args["b"]);
-	o_slaa_trans_red = std::stoi(args["c"]);
-	o_single_init_state = std::stoi(args["i"]);
-	o_slaa_determ = std::stoi(args["d"]);
-	o_eq_level = std::stoi(args["e"]);
-	o_ltl_split = std::stoi(args["l"]);
-	o_mergeable_info = std::stoi(args["m"]);
-	o_try_negation = std::stoi(args["n"]);
-	o_simplify_formula = std::stoi(args["s"]);
-	o_ac_filter_fin = std::stoi(args["t"]);
-	o_debug = std::stoi(args["x"]);
-
-	o_deterministic = std::stoi(args["D"]);
-
-	o_u_merge_level = std::stoi(args["F"]);
-	o_g_merge_level = std::stoi(args["G"]);
-	o_disj_merging = std::stoi(args["O"]);
-	o_x_single_succ = std::stoi(args["X"]);
-
-	// -O1 implies -i1
-	o_single_init_state = o_single_init_state || o_disj_merging;
+	set_options(args);
 
 	unsigned int print_phase = std::stoi(args["p"]);
 
 	// -p1 implies -l0
 	o_ltl_split = o_ltl_split && (print_phase & 2);
 
-	// -x2 implies -b1 (mind the bitwise operations)
-	if (o_debug & 2) {
-		o_try_ltl2tgba_spotela = o_try_ltl2tgba_spotela | 1;
+	int bdd_status = bdd_init(std::stoi(args["M"]), std::stoi(args["Q"]));
+	if (bdd_status < 0) {
+		std::cerr << "Unable to initialize the BDD library: " << bdd_errstring(bdd_status) << ".\n";
+		return 2;
+	}
+	bdd_setmaxincrease(std::stoi(args["R"]));
+	// count the garbage collections instead of printing messages
+	bdd_gbc_hook(count_bdd_gc);
+
+	if (args.count("H") > 0) {
+		try {
+			load_prediction_table(args["H"]);
+		} catch (std::runtime_error& e) {
+			std::cerr << e.what() << '\n';
+			return 2;
+		}
 	}
 
-	spot::twa_graph_ptr nwa = nullptr;
-	SLAA* slaa = nullptr;
-	std::string stats("");
+	// one BDD dictionary is shared by all translated formulae
+	auto dict = spot::make_bdd_dict();
 
-	try {
-		std::tie(nwa, slaa, stats) = build_best_nwa(f, nullptr, print_phase & 1, print_phase == 1);
+	if (args.count("f") > 0) {
+		return translate_and_print(args["f"], args, dict, print_phase);
+	}
 
-		f = simplify_formula(f);
+	// batch mode: translate each non-empty line of the input as a formula
+	std::ifstream input_file;
+	if (args["I"] != "-") {
+		input_file.open(args["I"]);
+		if (!input_file) {
+			std::cerr << "Unable to open the input file " << args["I"] << ".\n";
+			return 2;
+		}
+	}
+	std::istream& input = args["I"] == "-" ? std::cin : input_file;
 
-		if (o_ltl_split) {
-			auto dict = nwa->get_dict();
+	unsigned jobs = std::stoi(args["j"]);
 
-			spot::twa_graph_ptr nwa_prod;
-			std::string stats_prod;
+	int exit_code = 0;
+	unsigned line_no = 0;
+	std::string line;
 
-			std::tie(nwa_prod, stats_prod) = build_product_nwa(f, dict);
-			std::tie(nwa, stats) = compare_automata(nwa, nwa_prod, stats, stats_prod);
-		}
-	} catch (std::runtime_error& e) {
-		std::string what(e.what());
-
-		if (what.find("Too many acceptance sets used.") == 0) {
-			std::cerr << "LTL3TELA is unable to set more than 32 acceptance marks.\n";
-			return 32;
-		} else {
-			std::cerr << what << std::endl;
-			return 3;
-		}
-	}
+	if (jobs <= 1) {
+		while (std::getline(input, line)) {
+			++line_no;
 
-	if (slaa) {
-		if (args["o"] == "dot") {
-			slaa->print_dot();
-		} else {
-			slaa->print_hoaf();
-		}
+			if (line.find_first_not_of(" \t\r") == std::string::npos) {
+				continue;
+			}
 
-		delete slaa;
-	}
+			// a failure of one formula does not stop the batch
+			int ret = translate_and_print(line, args, dict, print_phase);
+			if (ret != 0) {
+				std::cerr << "The formula on line " << line_no << " was not translated.\n";
+				exit_code = ret;
+			}
 
-	if (nwa) {
-		if (args["o"] == "dot") {
-			spot::print_dot(std::cout, nwa);
-		} else {
-			spot::print_hoa(std::cout, nwa);
-			std::cout << '\n';
+			// each automaton is written as soon as it is produced
+			std::cout.flush();
+		}
+	} else {
+		// the formulae are distributed among worker processes
+		// and their outputs are printed in the input order
+		std::vector<std::pair<unsigned, std::string>> formulae;
+		while (std::getline(input, line)) {
+			++line_no;
+
+			if (line.find_first_not_of(" \t\r") != std::string::npos) {
+				formulae.push_back(std::make_pair(line_no, line));
+			}
 		}
-	}
 
-	if (o_debug & 1) {
-		std::cerr << stats;
+		run_in_workers(formulae.size(), jobs,
+			[&](unsigned i) {
+				return capture_output([&]() {
+					return translate_and_print(formulae[i].second, args, dict, print_phase);
+				});
+			},
+			[&](unsigned i, const task_result& r) {
+				std::cout << r.out;
+				std::cerr << r.err;
+
+				if (r.exit_code != 0) {
+					std::cerr << "The formula on line " << formulae[i].first << " was not translated.\n";
+					exit_code = r.exit_code;
+				}
+
+				std::cout.flush();
+			}
+		);
 	}
 
+	// release the labels of cached SLAA fragments while BDDs are still alive
+	clear_slaa_fragment_cache();
+
 	// do not call bdd_done(), we use libbddx
 
-	return 0;
+	return exit_code;
 }
@@ -18,24 +18,58 @@
 */
 
 #include "nondeterministic.hpp"
+#include "telemetry.hpp"
 
-// Returns the id for a set of SLAA states
-// It creates a new state if not present
-unsigned get_state_id_for_set(spot::twa_graph_ptr aut, std::set<unsigned> state_set) {
-	auto sets = aut->get_named_prop<std::vector<std::set<unsigned>>>("state-sets");
+// the resources of the candidate being translated, see start_candidate_budget
+std::chrono::steady_clock::time_point candidate_start;
+unsigned candidate_state_bound = 0;
 
-	for (unsigned i = 0; i < sets->size(); ++i) {
-		std::set<unsigned> candidate = (*sets)[i];
-		if (candidate == state_set) {
-			return i;
+const std::string budget_exceeded_message("Candidate budget exceeded.");
+
+void start_candidate_budget(unsigned state_bound /* = 0 */) {
+	candidate_start = std::chrono::steady_clock::now();
+	candidate_state_bound = state_bound;
+}
+
+bool is_budget_exceeded(const std::runtime_error& e) {
+	return std::string(e.what()).find(budget_exceeded_message) == 0;
+}
+
+// throws if the candidate with na_states states so far has exceeded one of its
+// budgets; a finished candidate (reduced and postprocessed, as the best one) is
+// also given up if it is larger than the best one
+void check_candidate_budget(unsigned na_states, bool finished = false) {
+	if ((o_state_budget > 0 && na_states > o_state_budget)
+		|| (finished && candidate_state_bound > 0 && na_states > candidate_state_bound)
+		|| (o_bdd_budget > 0 && (unsigned)bdd_getnodenum() > o_bdd_budget)) {
+		throw std::runtime_error(budget_exceeded_message);
+	}
+
+	if (o_time_budget > 0) {
+		auto elapsed = std::chrono::steady_clock::now() - candidate_start;
+		if (std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() > o_time_budget) {
+			throw std::runtime_error(budget_exceeded_message);
 		}
 	}
+}
+
+// Returns the id for a set of SLAA states
+// It creates a new state if not present
+// set_ids interns the sets already stored in the "state-sets" property
+unsigned get_state_id_for_set(spot::twa_graph_ptr aut, std::unordered_map<std::set<unsigned>, unsigned, set_hash>& set_ids, const std::set<unsigned>& state_set) {
+	auto id_it = set_ids.find(state_set);
+	if (id_it != set_ids.end()) {
+		return id_it->second;
+	}
+
+	auto sets = aut->get_named_prop<std::vector<std::set<unsigned>>>("state-sets");
 
 	unsigned i = aut->new_state();
 	if (i != sets->size()) {
 		throw "Unexpected index.";
 	} else {
 		sets->push_back(state_set);
+		set_ids.insert(std::make_pair(state_set, i));
 		return i;
 	}
 }
@@ -55,8 +89,111 @@ std::string set_to_str(std::set<unsigned> set) {
 	return name;
 }
 
+// Returns a map { mark => mark } of the siblings of Fin-marks removed from NA
+std::map<acc_mark, acc_mark> get_removed_fin_siblings(const SLAA::ac_representation& acr, const std::map<acc_mark, unsigned>& tgba_mark_owners) {
+	std::map<acc_mark, acc_mark> sibling_of_removed_fin;
+	for (auto& disj : acr) {
+		for (auto& conj : disj) {
+			for (auto& pair : conj) {
+				if (tgba_mark_owners.count(pair.first) > 0) {
+					sibling_of_removed_fin.insert(pair);
+				}
+			}
+		}
+	}
+
+	return sibling_of_removed_fin;
+}
+
+// Replaces the removed Fin-marks of a NA edge going to `target_set' as LTL2BA does
+void assign_tgba_marks(SLAA* slaa, const std::map<acc_mark, unsigned>& tgba_mark_owners, const std::map<acc_mark, acc_mark>& sibling_of_removed_fin, const std::set<unsigned>& target_set, bdd label, id_set& marks) {
+	for (auto& rec : tgba_mark_owners) {
+		// is the transition marked by the appropriate mark?
+		if (marks.count(rec.first) == 0) {
+			// no; does this edge go somewhere else than the source state?
+			if (target_set.count(rec.second) == 0) {
+				// yes so add the sibling
+				marks.insert(sibling_of_removed_fin.at(rec.first));
+			} else {
+				// find some edge f from target state that satisfies:
+				// 1) f goes to subset of target_set not containing the owner of mark
+				// 2) f.label ⊆ current edge.label
+				for (auto& f_edge_id : slaa->get_state_edges(rec.second)) {
+					auto f_edge = slaa->get_edge(f_edge_id);
+					const auto& f_targets = f_edge->get_targets();
+
+					if (f_targets.count(rec.second) == 0
+						&& std::includes(target_set.begin(), target_set.end(), f_targets.begin(), f_targets.end())
+						&& ((label & bdd_not(f_edge->get_label())) == bdd_false())
+					) {
+						marks.insert(sibling_of_removed_fin.at(rec.first));
+						break;
+					}
+				}
+
+			}
+		} else {
+			// yes, remove it
+			marks.erase(rec.first);
+		}
+	}
+}
+
+// Builds the acceptance condition of NA from its representation given by SLAA
+// and fills the conversion table { old mark => new mark } for the used marks
+spot::acc_cond::acc_code build_na_acceptance(const SLAA::ac_representation& acr, const std::map<acc_mark, unsigned>& tgba_mark_owners, const std::set<acc_mark>& used_marks, std::map<acc_mark, acc_mark>& mark_conversion) {
+	acc_mark mark_counter = 0;
+	for (auto old_mark : used_marks) {
+		mark_conversion[old_mark] = mark_counter;
+		++mark_counter;
+	}
+
+	auto acceptance = spot::acc_cond::acc_code::t();
+	for (auto& disj : acr) {
+		auto disj_f = spot::acc_cond::acc_code::f();
+
+		bool not_having_true = false;
+		for (auto& conj : disj) {
+			auto conj_f = spot::acc_cond::acc_code::t();
+
+			for (auto& pair : conj) {
+				if (tgba_mark_owners.count(pair.first) > 0) {
+					if (used_marks.count(pair.second) > 0) {
+						conj_f &= spot::acc_cond::acc_code::inf(spot::acc_cond::mark_t({ mark_conversion[pair.second] }));
+					} else {
+						// Inf(unused mark) can be never satisfied
+						conj_f &= spot::acc_cond::acc_code::f();
+					}
+					not_having_true = true;
+				} else {
+					bool fin_used = used_marks.count(pair.first) > 0;
+					bool inf_used = used_marks.count(pair.second) > 0;
+
+					if (fin_used && inf_used) {
+						conj_f &= spot::acc_cond::acc_code::fin(spot::acc_cond::mark_t({ mark_conversion[pair.first] })) | spot::acc_cond::acc_code::inf(spot::acc_cond::mark_t({ mark_conversion[pair.second] }));
+						not_having_true = true;
+					} else if (fin_used) {
+						// Inf cannot be satisfied, so we rely on Fin
+						conj_f &= spot::acc_cond::acc_code::fin(spot::acc_cond::mark_t({ mark_conversion[pair.first] }));
+						not_having_true = true;
+					}
+				}
+			}
+			disj_f |= conj_f;
+		}
+
+		if (not_having_true) {
+			acceptance &= disj_f;
+		}
+	}
+
+	return acceptance;
+}
+
 // Converts a given SLAA to NA
 spot::twa_graph_ptr make_nondeterministic(SLAA* slaa) {
+	phase_telemetry telemetry("make_nondeterministic");
+
 	unsigned last_inserted = 0;
 
 	// create an empty automaton
@@ -70,18 +207,21 @@ spot::twa_graph_ptr make_nondeterministic(SLAA* slaa) {
 	// create a map of names
 	auto sets = new std::vector<std::set<unsigned>>;
 	aut->set_named_prop<std::vector<std::set<unsigned>>>("state-sets", sets);
+	// index of the sets above
+	std::unordered_map<std::set<unsigned>, unsigned, set_hash> set_ids;
 
 	// a map { mark => SLAA state } of Fin-marks removed from NA
 	// filled only if -t flag is active
 	std::map<acc_mark, unsigned> tgba_mark_owners;
 	// acr is a representation of the final acceptance condition
 	auto acr = slaa->mark_transformation(tgba_mark_owners);
-
-	auto& ac = aut->acc();
+	// drop products left over by an interrupted run on this SLAA
+	slaa->clear_product_cache();
 
 	std::queue<unsigned> q;
 
-	NA* nha = new NA(sets);
+	// freed on return and when the candidate exceeds its budget
+	std::unique_ptr<NA> nha(new NA(sets));
 	// copy the Inf-marks from SLAA
 	nha->remember_inf_mark(slaa->get_inf_marks());
 	// put initial configurations into queue, create states
@@ -89,7 +229,7 @@ spot::twa_graph_ptr make_nondeterministic(SLAA* slaa) {
 	std::set<unsigned> na_init_states;
 
 	for(auto& init_set : slaa->get_init_sets()) {
-		auto index = get_state_id_for_set(aut, init_set);
+		auto index = get_state_id_for_set(aut, set_ids, init_set);
 
 		q.push(index);
 		// ignore the return value, just make sure we create the state
@@ -98,64 +238,59 @@ spot::twa_graph_ptr make_nondeterministic(SLAA* slaa) {
 		last_inserted = index;
 	}
 
-	// map { mark => set of owner SLAA states } of Fin-marks removed from NA
-	std::map<acc_mark, std::set<unsigned>> removed_fin_marks;
-
 	// map { mark => mark } of the siblings of removed Fin-marks
-	std::map<acc_mark, acc_mark> sibling_of_removed_fin;
-	for (auto& disj : acr) {
-		auto disj_f = spot::acc_cond::acc_code::f();
-
-		for (auto& conj : disj) {
-			for (auto& pair : conj) {
-				if (tgba_mark_owners.count(pair.first) > 0) {
-					sibling_of_removed_fin.insert(pair);
-				}
-			}
-		}
-	}
+	auto sibling_of_removed_fin = get_removed_fin_siblings(acr, tgba_mark_owners);
 
 	// while the queue is not empty, create a state using the subset construction
-	while(!q.empty()) {
-		auto source_id = q.front();
-		q.pop();
-		std::set<unsigned> source_sets = (*sets) [source_id];
-
-		if (source_sets.size() == 0) {
-			// if the state is ∅, add a true loop
-			nha->add_edge(nha->get_state_id(source_id), bdd_true(), std::set<unsigned>({ nha->get_state_id(source_id) }));
-		} else {
-			// count the product
-			std::set<std::set<unsigned>> edges_for_product;
-			for (auto& state_id : source_sets) {
-				edges_for_product.insert(slaa->get_state_edges(state_id));
-			}
+	{
+		phase_telemetry subset_telemetry("subset_construction");
 
-			std::set<unsigned> product_edges = slaa->product(edges_for_product, true);
+		while(!q.empty()) {
+			check_candidate_budget(aut->num_states());
 
-			// check each successor and if needed, create a new state and add to queue
-			for (auto& edge_id : product_edges) {
-				auto label = slaa->get_edge(edge_id)->get_label();
-				// do not add the false edges
-				if (label == bddfalse) {
-					continue;
-				}
+			auto source_id = q.front();
+			q.pop();
+			std::set<unsigned> source_sets = (*sets) [source_id];
 
-				std::set<unsigned> targets = slaa->get_edge(edge_id)->get_targets();
+			if (source_sets.size() == 0) {
+				// if the state is ∅, add a true loop
+				nha->add_edge(nha->get_state_id(source_id), bdd_true(), id_set({ nha->get_state_id(source_id) }));
+			} else {
+				// count the product; products of SLAA states shared by
+				// several NA states are computed only once
+				const std::set<unsigned>& product_edges = slaa->state_product(source_sets, true);
+
+				// check each successor and if needed, create a new state and add to queue
+				for (auto& edge_id : product_edges) {
+					auto label = slaa->get_edge(edge_id)->get_label();
+					// do not add the false edges
+					if (label == bddfalse) {
+						continue;
+					}
 
-				// creates state if not existe for given set
-				unsigned target_id = get_state_id_for_set(aut, targets);
-				if (target_id > last_inserted) {
-					last_inserted = target_id;
-					q.push(target_id);
-				}
+					const auto& edge_targets = slaa->get_edge(edge_id)->get_targets();
+					std::set<unsigned> targets(edge_targets.begin(), edge_targets.end());
+
+					// creates state if not existe for given set
+					unsigned target_id = get_state_id_for_set(aut, set_ids, targets);
+					if (target_id > last_inserted) {
+						last_inserted = target_id;
+						q.push(target_id);
+					}
 
-				auto marks = slaa->get_edge(edge_id)->get_marks();
-				nha->add_edge(nha->get_state_id(source_id), label, std::set<unsigned>({ nha->get_state_id(target_id) }), marks);
+					const auto& marks = slaa->get_edge(edge_id)->get_marks();
+					nha->add_edge(nha->get_state_id(source_id), label, id_set({ nha->get_state_id(target_id) }), marks);
+				}
 			}
 		}
+
+		subset_telemetry.count("na_states", nha->states_count());
+		subset_telemetry.count("na_edges", nha->edges_count());
 	}
 
+	// the memoised products are not valid once the SLAA changes
+	slaa->clear_product_cache();
+
 	// do we have more than one init state?
 	// if so, we'll merge them to one new state
 	unsigned spot_init_state_id = 0;
@@ -192,66 +327,61 @@ spot::twa_graph_ptr make_nondeterministic(SLAA* slaa) {
 	aut->set_named_prop<std::vector<std::string>>("state-names", sn);
 
 	// merge edges with the same source and destination
-	nha->merge_edges();
+	{
+		phase_telemetry merge_telemetry("merge_edges");
+		nha->merge_edges();
+		merge_telemetry.count("na_edges", nha->edges_count());
+	}
 
 	// assign the marks as LTL2BA does
-	for (unsigned st_id = 0, st_count = nha->states_count(); st_id < st_count; ++st_id) {
-		auto source_id = nha->state_name(st_id);
+	{
+		phase_telemetry relabel_telemetry("mark_relabel");
+
+		// the relabelled edges may dominate the edges that are yet to be
+		// relabelled; keep their IDs from being reused until the loop ends
+		nha->hold_edge_release(true);
+		for (unsigned st_id = 0, st_count = nha->states_count(); st_id < st_count; ++st_id) {
+			auto source_id = nha->state_name(st_id);
+
+			for (auto& edge_id : nha->get_state_edges(st_id)) {
+				if (!nha->has_edge(source_id, edge_id)) {
+					// a relabelled edge has dominated it and it has been released
+					continue;
+				}
 
-		for (auto& edge_id : nha->get_state_edges(st_id)) {
-			auto edge = nha->get_edge(edge_id);
+				auto edge = nha->get_edge(edge_id);
 
-			auto targets = edge->get_targets();
-			auto target_id = nha->state_name(*(targets.begin()));
-			auto label = edge->get_label();
-			auto marks = edge->get_marks();
-			auto target_set = (*sets)[target_id];
-
-			for (auto& rec : tgba_mark_owners) {
-				// is the transition marked by the appropriate mark?
-				if (marks.count(rec.first) == 0) {
-					// no; does this edge go somewhere else than the source state?
-					if (target_set.count(rec.second) == 0) {
-						// yes so add the sibling
-						marks.insert(sibling_of_removed_fin[rec.first]);
-					} else {
-						// find some edge f from target state that satisfies:
-						// 1) f goes to subset of target_set not containing the owner of mark
-						// 2) f.label ⊆ current edge.label
-						for (auto& f_edge_id : slaa->get_state_edges(rec.second)) {
-							auto f_edge = slaa->get_edge(f_edge_id);
-							auto f_targets = f_edge->get_targets();
-
-							if (f_targets.count(rec.second) == 0
-								&& std::includes(target_set.begin(), target_set.end(), f_targets.begin(), f_targets.end())
-								&& ((label & bdd_not(f_edge->get_label())) == bdd_false())
-							) {
-								marks.insert(sibling_of_removed_fin[rec.first]);
-								break;
-							}
-						}
+				auto targets = edge->get_targets();
+				auto target_id = nha->state_name(*(targets.begin()));
+				auto label = edge->get_label();
+				auto marks = edge->get_marks();
+				auto target_set = (*sets)[target_id];
 
-					}
-				} else {
-					// yes, remove it
-					marks.erase(rec.first);
-				}
-			}
+				assign_tgba_marks(slaa, tgba_mark_owners, sibling_of_removed_fin, target_set, label, marks);
 
-			// remove old edge and add the updated one
-			nha->remove_edge(source_id, edge_id);
-			nha->add_edge(source_id, label, targets, marks);
+				// remove old edge and add the updated one
+				nha->remove_edge(source_id, edge_id);
+				nha->release_edge(edge_id);
+				nha->add_edge(source_id, label, targets, marks);
+			}
 		}
+		nha->hold_edge_release(false);
 	}
 
 	// we merge edges again
-	nha->merge_edges();
+	{
+		phase_telemetry merge_telemetry("merge_edges");
+		nha->merge_edges();
+		merge_telemetry.count("na_edges", nha->edges_count());
+	}
 	// some states may become unreachable
 	nha->remove_unreachable_states();
 
 	// merge the equivalent states
 	if (o_eq_level > 0) {
+		phase_telemetry merge_telemetry("merge_equivalent_states");
 		nha->merge_equivalent_states();
+		merge_telemetry.count("na_states", nha->states_count());
 	}
 
 	// again, some may become unreachable
@@ -262,60 +392,19 @@ spot::twa_graph_ptr make_nondeterministic(SLAA* slaa) {
 
 	for (unsigned st_id = 0, st_count = nha->states_count(); st_id < st_count; ++st_id) {
 		for (auto& edge_id : nha->get_state_edges(st_id)) {
-			auto j = nha->get_edge(edge_id)->get_marks();
+			const auto& j = nha->get_edge(edge_id)->get_marks();
 			used_marks.insert(j.begin(), j.end());
 		}
 	}
 
-	// create a conversion table { old mark => new mark }
-	std::map<acc_mark, acc_mark> mark_conversion;
-	acc_mark mark_counter = 0;
-	for (auto old_mark : used_marks) {
-		mark_conversion[old_mark] = mark_counter;
-		++mark_counter;
-	}
-
 	// reset spot's init state
 	aut->set_init_state(nha->state_name(nha->get_init_state()));
 
-	// build the acceptance condition
-	for (auto& disj : acr) {
-		auto disj_f = spot::acc_cond::acc_code::f();
-
-		bool not_having_true = false;
-		for (auto& conj : disj) {
-			auto conj_f = spot::acc_cond::acc_code::t();
-
-			for (auto& pair : conj) {
-				if (tgba_mark_owners.count(pair.first) > 0) {
-					if (used_marks.count(pair.second) > 0) {
-						conj_f &= ac.inf(spot::acc_cond::mark_t({ mark_conversion[pair.second] }));
-					} else {
-						// Inf(unused mark) can be never satisfied
-						conj_f &= spot::acc_cond::acc_code::f();
-					}
-					not_having_true = true;
-				} else {
-					bool fin_used = used_marks.count(pair.first) > 0;
-					bool inf_used = used_marks.count(pair.second) > 0;
-
-					if (fin_used && inf_used) {
-						conj_f &= ac.fin(spot::acc_cond::mark_t({ mark_conversion[pair.first] })) | ac.inf(spot::acc_cond::mark_t({ mark_conversion[pair.second] }));
-						not_having_true = true;
-					} else if (fin_used) {
-						// Inf cannot be satisfied, so we rely on Fin
-						conj_f &= ac.fin(spot::acc_cond::mark_t({ mark_conversion[pair.first] }));
-						not_having_true = true;
-					}
-				}
-			}
-			disj_f |= conj_f;
-		}
-
-		if (not_having_true) {
-			ac.set_acceptance(ac.get_acceptance() & disj_f);
-		}
-		aut->set_acceptance(used_marks.size(), ac.get_acceptance());
+	// build the acceptance condition and a conversion table { old mark => new mark }
+	std::map<acc_mark, acc_mark> mark_conversion;
+	auto acceptance = build_na_acceptance(acr, tgba_mark_owners, used_marks, mark_conversion);
+	if (!acr.empty()) {
+		aut->set_acceptance(used_marks.size(), acceptance);
 	}
 
 	// now we can finally create the Spot structure
@@ -327,7 +416,7 @@ spot::twa_graph_ptr make_nondeterministic(SLAA* slaa) {
 
 			auto target_id = nha->state_name(*(edge->get_targets().begin()));
 			auto label = edge->get_label();
-			auto marks = edge->get_marks();
+			const auto& marks = edge->get_marks();
 
 			std::set<acc_mark> marks_relabelled;
 			for (auto mark : marks) {
@@ -338,13 +427,258 @@ spot::twa_graph_ptr make_nondeterministic(SLAA* slaa) {
 		}
 	}
 
-	aut = spot::scc_filter(aut);
+	{
+		phase_telemetry scc_telemetry("scc_filter");
+		aut = spot::scc_filter(aut);
+		scc_telemetry.count("na_states", aut->num_states());
+		scc_telemetry.count("na_edges", aut->num_edges());
+	}
 	aut = try_postprocessing(aut);
+	// the postprocessing counts towards the budgets too
+	check_candidate_budget(aut->num_states(), true);
+
+	telemetry.count("na_states", aut->num_states());
+	telemetry.count("na_edges", aut->num_edges());
 
 	return aut;
 }
 
+// A state of the lazily explored NA: a set of SLAA states, or an artificial
+// initial state that joins several initial configurations of SLAA
+class lazy_na_state : public spot::state {
+public:
+	std::set<unsigned> slaa_states;
+	bool is_init;
+
+	lazy_na_state(std::set<unsigned> s, bool init = false) : slaa_states(std::move(s)), is_init(init) {}
+
+	int compare(const spot::state* other) const override {
+		auto o = static_cast<const lazy_na_state*>(other);
+		if (is_init != o->is_init) {
+			return is_init ? -1 : 1;
+		}
+		if (slaa_states < o->slaa_states) {
+			return -1;
+		}
+		return o->slaa_states < slaa_states ? 1 : 0;
+	}
+
+	size_t hash() const override {
+		return set_hash()(slaa_states) ^ is_init;
+	}
+
+	lazy_na_state* clone() const override {
+		return new lazy_na_state(*this);
+	}
+};
+
+typedef struct {
+	bdd label;
+	std::set<unsigned> target;
+	spot::acc_cond::mark_t marks;
+} lazy_na_transition;
+
+// Iterates over precomputed successors of a lazy_na_state
+class lazy_na_succ_iterator : public spot::twa_succ_iterator {
+	std::vector<lazy_na_transition> transitions;
+	unsigned pos = 0;
+
+public:
+	lazy_na_succ_iterator(std::vector<lazy_na_transition> t) : transitions(std::move(t)) {}
+
+	bool first() override {
+		pos = 0;
+		return !done();
+	}
+
+	bool next() override {
+		++pos;
+		return !done();
+	}
+
+	bool done() const override {
+		return pos >= transitions.size();
+	}
+
+	const spot::state* dst() const override {
+		return new lazy_na_state(transitions[pos].target);
+	}
+
+	bdd cond() const override {
+		return transitions[pos].label;
+	}
+
+	spot::acc_cond::mark_t acc() const override {
+		return transitions[pos].marks;
+	}
+};
+
+// NA equivalent to the given SLAA whose successors are computed on demand
+// the transitions are neither merged nor reduced by domination and the states
+// are not merged, so the automaton is usually larger than the one built by
+// make_nondeterministic, but only the explored part is ever stored
+class lazy_na : public spot::twa {
+	std::unique_ptr<SLAA> slaa;
+	std::set<std::set<unsigned>> init_sets;
+
+	// a map { mark => SLAA state } of Fin-marks removed from NA (-t flag)
+	std::map<acc_mark, unsigned> tgba_mark_owners;
+	std::map<acc_mark, acc_mark> sibling_of_removed_fin;
+	std::map<acc_mark, acc_mark> mark_conversion;
+
+public:
+	lazy_na(SLAA* s) : spot::twa(s->spot_bdd_dict), slaa(s) {
+		copy_ap_of(slaa->spot_aut);
+
+		auto acr = slaa->mark_transformation(tgba_mark_owners);
+		slaa->clear_product_cache();
+		sibling_of_removed_fin = get_removed_fin_siblings(acr, tgba_mark_owners);
+		init_sets = slaa->get_init_sets();
+
+		// we cannot know which marks will be used before the exploration,
+		// so take every mark that may appear on some edge
+		std::set<acc_mark> used_marks;
+		for (unsigned st_id = 0, st_count = slaa->states_count(); st_id < st_count; ++st_id) {
+			for (auto& edge_id : slaa->get_state_edges(st_id)) {
+				for (auto mark : slaa->get_edge(edge_id)->get_marks()) {
+					if (tgba_mark_owners.count(mark) == 0) {
+						used_marks.insert(mark);
+					}
+				}
+			}
+		}
+		for (auto& rec : sibling_of_removed_fin) {
+			used_marks.insert(rec.second);
+		}
+
+		auto acceptance = build_na_acceptance(acr, tgba_mark_owners, used_marks, mark_conversion);
+		if (!acr.empty()) {
+			set_acceptance(used_marks.size(), acceptance);
+		}
+	}
+
+	const spot::state* get_init_state() const override {
+		if (init_sets.size() == 1) {
+			return new lazy_na_state(*init_sets.begin());
+		}
+
+		return new lazy_na_state(std::set<unsigned>(), true);
+	}
+
+	spot::twa_succ_iterator* succ_iter(const spot::state* state) const override {
+		auto s = static_cast<const lazy_na_state*>(state);
+
+		// the artificial initial state has the transitions of all initial configurations
+		std::set<std::set<unsigned>> sources;
+		if (s->is_init) {
+			sources = init_sets;
+		} else {
+			sources.insert(s->slaa_states);
+		}
+
+		// edges with the same target and marks are merged
+		std::map<std::pair<std::set<unsigned>, std::set<acc_mark>>, bdd> successors;
+		auto add_successor = [&](std::set<unsigned> target_set, bdd label, id_set marks) {
+			// the marks are assigned as by make_nondeterministic
+			assign_tgba_marks(slaa.get(), tgba_mark_owners, sibling_of_removed_fin, target_set, label, marks);
+
+			std::set<acc_mark> marks_relabelled;
+			for (auto mark : marks) {
+				marks_relabelled.insert(mark_conversion.at(mark));
+			}
+
+			auto key = std::make_pair(std::move(target_set), std::move(marks_relabelled));
+			auto it = successors.find(key);
+			if (it == successors.end()) {
+				successors.emplace(std::move(key), label);
+			} else {
+				it->second |= label;
+			}
+		};
+
+		for (auto& source : sources) {
+			if (source.empty()) {
+				// the ∅ state is true and has a true loop
+				add_successor(source, bddtrue, id_set());
+				continue;
+			}
+
+			for (auto& edge_id : slaa->state_product(source, true)) {
+				auto edge = slaa->get_edge(edge_id);
+				const auto& edge_targets = edge->get_targets();
+				add_successor(std::set<unsigned>(edge_targets.begin(), edge_targets.end()), edge->get_label(), edge->get_marks());
+			}
+
+			// keep only the explored part of the automaton in memory
+			slaa->clear_product_cache();
+		}
+
+		std::vector<lazy_na_transition> transitions;
+		for (auto& succ : successors) {
+			transitions.push_back({
+				succ.second,
+				succ.first.first,
+				spot::acc_cond::mark_t(succ.first.second.begin(), succ.first.second.end())
+			});
+		}
+
+		return new lazy_na_succ_iterator(std::move(transitions));
+	}
+
+	std::string format_state(const spot::state* state) const override {
+		auto s = static_cast<const lazy_na_state*>(state);
+		return s->is_init ? "init" : set_to_str(s->slaa_states);
+	}
+};
+
+spot::twa_ptr make_nondeterministic_lazy(SLAA* slaa) {
+	return std::make_shared<lazy_na>(slaa);
+}
+
+void check_lazy_nondeterministic(spot::formula f, spot::bdd_dict_ptr dict, spot::twa_graph_ptr nwa) {
+	// the lazy NA takes a fresh SLAA as make_nondeterministic changes its marks
+	std::unique_ptr<SLAA> slaa(make_alternating(f, dict));
+	slaa->remove_unreachable_states();
+	slaa->remove_unnecessary_marks();
+
+	auto lazy = make_nondeterministic_lazy(slaa.release());
+	auto explored = spot::make_twa_graph(lazy, spot::twa::prop_set::all());
+
+	if (!spot::are_equivalent(nwa, explored)) {
+		throw std::runtime_error("The on-the-fly NA of " + str_psl(f) + " differs from the NA built by make_nondeterministic.");
+	}
+}
+
+spot::twa_graph_ptr run_ltl2tgba(spot::formula f, spot::bdd_dict_ptr dict) {
+	spot::twa_graph_ptr aut;
+
+	if (dict) {
+		spot::translator ltl2tgba(dict);
+		if (o_deterministic) {
+			ltl2tgba.set_pref(spot::postprocessor::Deterministic);
+		}
+		ltl2tgba.set_type(spot::postprocessor::Generic);
+		ltl2tgba.set_level(spot::postprocessor::High);
+		aut = ltl2tgba.run(f);
+	} else {
+		spot::translator ltl2tgba;
+		if (o_deterministic) {
+			ltl2tgba.set_pref(spot::postprocessor::Deterministic);
+		}
+		ltl2tgba.set_type(spot::postprocessor::Generic);
+		ltl2tgba.set_level(spot::postprocessor::High);
+		aut = ltl2tgba.run(f);
+	}
+
+	return try_postprocessing(aut);
+}
+
 std::tuple<spot::twa_graph_ptr, SLAA*, std::string> build_best_nwa(spot::formula f, spot::bdd_dict_ptr dict /* = nullptr */, bool print_alternating /* = false */, bool exit_after_alternating /* = false */) {
+	// the portfolio cannot pass the SLAA from its workers
+	if (o_portfolio && !print_alternating && !exit_after_alternating && !o_mergeable_info) {
+		return build_best_nwa_portfolio(f, dict);
+	}
+
 	spot::twa_graph_ptr nwa = nullptr;
 	SLAA* slaa_out = nullptr;
 
@@ -355,7 +689,13 @@ std::tuple<spot::twa_graph_ptr, SLAA*, std::string> build_best_nwa(spot::formula
 	auto orig_f = f;
 	f = simplify_formula(f);
 
-	for (unsigned neg = 0; neg <= (o_try_negation && !exit_after_alternating) && use_ltl3tela_algorithm; ++neg) {
+	bool try_negation = o_try_negation;
+	bool try_spot = o_try_ltl2tgba_spotela & 1;
+	if (!exit_after_alternating && !print_alternating) {
+		prescreen_candidates(f, use_ltl3tela_algorithm, try_negation, try_spot);
+	}
+
+	for (unsigned neg = 0; neg <= (try_negation && !exit_after_alternating) && use_ltl3tela_algorithm; ++neg) {
 		// neg means we try to negate the formula and complement
 		// the resulting automaton, if it's deterministic
 		// we then choose the smaller of the two automata
@@ -364,7 +704,17 @@ std::tuple<spot::twa_graph_ptr, SLAA*, std::string> build_best_nwa(spot::formula
 		}
 
 		try {
+			// with -k, the negated candidate can only win if it is not
+			// larger than the automaton we already have
+			unsigned state_bound = 0;
+			if (o_budget_cutoff && neg && !we_crashed && (!o_deterministic || spot::is_universal(nwa))) {
+				state_bound = nwa->num_states();
+			}
+			start_candidate_budget(state_bound);
+
 			auto slaa = make_alternating(f, dict);
+			// the SLAA is freed at the end of the iteration unless it is returned
+			std::unique_ptr<SLAA> slaa_owner(slaa);
 
 			if (o_mergeable_info) {
 				// If some mergeable is present, true is already outputed
@@ -377,32 +727,49 @@ std::tuple<spot::twa_graph_ptr, SLAA*, std::string> build_best_nwa(spot::formula
 			slaa->remove_unnecessary_marks();
 
 			if (print_alternating && !neg) {
-				slaa_out = slaa;
+				slaa_out = slaa_owner.release();
 			}
 
 			if (!exit_after_alternating) {
 				auto nwa_temp = make_nondeterministic(slaa);
-				if (!neg || we_crashed) {
+				if (o_check_lazy) {
+					check_lazy_nondeterministic(f, dict, nwa_temp);
+				}
+
+				if (!neg) {
 					// always assign the default value, nothing to compare
 					nwa = nwa_temp;
 				} else if (spot::is_universal(nwa_temp)) { // we are only interested if the automaton is deterministic
 					nwa_temp = spot::dualize(nwa_temp);
-					std::tie(nwa, stats) = compare_automata(nwa, nwa_temp, stats, "neg");
+					if (we_crashed) {
+						// the positive candidate failed, the complement is all we have
+						nwa = nwa_temp;
+						stats = "neg";
+						we_crashed = false;
+					} else {
+						std::tie(nwa, stats) = compare_automata(nwa, nwa_temp, stats, "neg");
+					}
 				}
+				// otherwise the automaton of the negation is dropped; if the positive
+				// candidate failed, we_crashed stays set and Spot's result is used
 
-				if (o_try_ltl2tgba_spotela & 2) {
+				if ((o_try_ltl2tgba_spotela & 2) && !we_crashed) {
 					auto nwa_spotela = spotela_simplify(nwa);
+					// so does SPOTELA
+					check_candidate_budget(nwa_spotela->num_states());
 					std::tie(nwa, stats) = compare_automata(nwa, nwa_spotela, stats, stats + "+spotela");
 				}
 			}
-
-			we_crashed = false;
 		} catch (std::runtime_error& e) {
 			std::string what(e.what());
 
 			if (what.find("Too many acceptance sets used.") == 0 && !exit_after_alternating) {
 				// nevermind, Spot will do it (hopefully)
 				we_crashed = true;
+			} else if (is_budget_exceeded(e)) {
+				// the negated candidate is simply dropped,
+				// the positive one is replaced by Spot
+				we_crashed = we_crashed || !neg;
 			} else {
 				// rethrow
 				throw e;
@@ -417,32 +784,13 @@ std::tuple<spot::twa_graph_ptr, SLAA*, std::string> build_best_nwa(spot::formula
 	}
 
 	if (!exit_after_alternating) {
-		if (o_try_ltl2tgba_spotela & 1) {
+		if (try_spot) {
 			spot::twa_graph_ptr nwa_spot;
 			std::string stats_spot("spot");
 
-			for (unsigned neg = 0; neg <= o_try_negation; ++neg) {
+			for (unsigned neg = 0; neg <= try_negation; ++neg) {
 				auto spot_f = neg ? spot::formula::Not(orig_f) : orig_f;
-				spot::twa_graph_ptr nwa_spot_temp;
-
-				if (dict) {
-					spot::translator ltl2tgba(dict);
-					if (o_deterministic) {
-						ltl2tgba.set_pref(spot::postprocessor::Deterministic);
-					}
-					ltl2tgba.set_type(spot::postprocessor::Generic);
-					ltl2tgba.set_level(spot::postprocessor::High);
-					nwa_spot_temp = ltl2tgba.run(spot_f);
-				} else {
-					spot::translator ltl2tgba;
-					if (o_deterministic) {
-						ltl2tgba.set_pref(spot::postprocessor::Deterministic);
-					}
-					ltl2tgba.set_type(spot::postprocessor::Generic);
-					ltl2tgba.set_level(spot::postprocessor::High);
-					nwa_spot_temp = ltl2tgba.run(spot_f);
-				}
-				nwa_spot_temp = try_postprocessing(nwa_spot_temp);
+				auto nwa_spot_temp = run_ltl2tgba(spot_f, dict);
 
 				if (!neg) {
 					// assign the default Spot automaton
@@ -467,6 +815,12 @@ std::tuple<spot::twa_graph_ptr, SLAA*, std::string> build_best_nwa(spot::formula
 		}
 	}
 
+	if (!nwa && !exit_after_alternating) {
+		// every candidate ran out of its budget, Spot has none
+		nwa = run_ltl2tgba(orig_f, dict);
+		stats = "spot";
+	}
+
 	stats += "\n";
 
 	return std::make_tuple(nwa, slaa_out, stats);
@@ -543,6 +897,8 @@ std::pair<spot::twa_graph_ptr, std::string> build_product_nwa(spot::formula f, s
 }
 
 spot::twa_graph_ptr try_postprocessing(spot::twa_graph_ptr aut) {
+	phase_telemetry telemetry("try_postprocessing");
+
 	spot::postprocessor pp;
 	pp.set_type(spot::postprocessor::Generic);
 	if (o_deterministic) {
@@ -552,6 +908,8 @@ spot::twa_graph_ptr try_postprocessing(spot::twa_graph_ptr aut) {
 	spot::cleanup_acceptance_here(p_aut);
 
 	aut = compare_automata(p_aut, aut).first;
+	telemetry.count("na_states", aut->num_states());
+	telemetry.count("na_edges", aut->num_edges());
 
 	return aut;
 }
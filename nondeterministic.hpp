@@ -19,9 +19,14 @@
 
 #ifndef NONDETERMINISTIC_H
 #define NONDETERMINISTIC_H
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
 #include <utility>
 #include <spot/tl/print.hh>
 #include <spot/twaalgos/cleanacc.hh>
+#include <spot/twaalgos/contains.hh>
 #include <spot/twaalgos/hoa.hh>
 #include <spot/twaalgos/postproc.hh>
 #include <spot/twaalgos/simulation.hh>
@@ -33,12 +38,32 @@
 #include "automaton.hpp"
 #include "alternating.hpp"
 #include "spotela.hpp"
+#include "portfolio.hpp"
+#include "predictor.hpp"
 #include "utils.hpp"
 
+// starts measuring the budgets (-T, -N, -B) of the next candidate of
+// build_best_nwa; if state_bound is positive, make_nondeterministic also
+// gives up if the postprocessed automaton has more than state_bound states (-k)
+void start_candidate_budget(unsigned state_bound = 0);
+
+// checks whether e was thrown because a candidate exceeded its budget
+bool is_budget_exceeded(const std::runtime_error& e);
+
 // turns the given SLAA into an equivalent nondeterministic
 // automaton in the Spot's structure
+// throws a runtime_error if the candidate exceeds its budget
 spot::twa_graph_ptr make_nondeterministic(SLAA* slaa);
 
+// turns the given SLAA into an equivalent nondeterministic automaton
+// whose states and transitions are computed on demand during exploration
+// the returned automaton takes ownership of the SLAA
+spot::twa_ptr make_nondeterministic_lazy(SLAA* slaa);
+
+// explores the on-the-fly NA of f and throws a runtime_error
+// if its language differs from the one of nwa (-L)
+void check_lazy_nondeterministic(spot::formula f, spot::bdd_dict_ptr dict, spot::twa_graph_ptr nwa);
+
 // chooses the best nondeterministic automaton for a given formula
 // returns nullptr in the first element of the pair if only alternating automaton is to be produced
 // returns nullptr in the second element if alternating automaton is not to be printed
@@ -48,4 +73,7 @@ std::pair<spot::twa_graph_ptr, std::string> build_product_nwa(spot::formula f, s
 
 spot::twa_graph_ptr try_postprocessing(spot::twa_graph_ptr aut);
 
+// translates f with Spot's ltl2tgba and postprocesses the result
+spot::twa_graph_ptr run_ltl2tgba(spot::formula f, spot::bdd_dict_ptr dict);
+
 #endif
@@ -0,0 +1,311 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "parallel.hpp"
+
+// writes the whole buffer to fd, returns false on failure
+bool write_all(int fd, const char* buf, size_t size) {
+	while (size > 0) {
+		auto written = write(fd, buf, size);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		buf += written;
+		size -= written;
+	}
+	return true;
+}
+
+// reads exactly size bytes from fd, returns false on failure or EOF
+bool read_all(int fd, char* buf, size_t size) {
+	while (size > 0) {
+		auto got = read(fd, buf, size);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			return false;
+		}
+		buf += got;
+		size -= got;
+	}
+	return true;
+}
+
+bool write_string(int fd, const std::string& s) {
+	uint64_t size = s.size();
+	return write_all(fd, reinterpret_cast<const char*>(&size), sizeof(size)) && write_all(fd, s.data(), s.size());
+}
+
+bool read_string(int fd, std::string& s) {
+	uint64_t size;
+	if (!read_all(fd, reinterpret_cast<char*>(&size), sizeof(size))) {
+		return false;
+	}
+	s.resize(size);
+	return size == 0 || read_all(fd, &s[0], size);
+}
+
+// a result is sent through the pipe as the exit code followed by the outputs and the log
+bool write_result(int fd, const task_result& r) {
+	int32_t exit_code = r.exit_code;
+	return write_all(fd, reinterpret_cast<const char*>(&exit_code), sizeof(exit_code))
+		&& write_string(fd, r.out) && write_string(fd, r.err) && write_string(fd, r.log);
+}
+
+bool read_result(int fd, task_result& r) {
+	int32_t exit_code;
+	if (!read_all(fd, reinterpret_cast<char*>(&exit_code), sizeof(exit_code))) {
+		return false;
+	}
+	r.exit_code = exit_code;
+	return read_string(fd, r.out) && read_string(fd, r.err) && read_string(fd, r.log);
+}
+
+task_result capture_output(std::function<int()> task) {
+	std::ostringstream out;
+	std::ostringstream err;
+
+	auto cout_buf = std::cout.rdbuf(out.rdbuf());
+	auto cerr_buf = std::cerr.rdbuf(err.rdbuf());
+
+	task_result r;
+	try {
+		r.exit_code = task();
+	} catch (...) {
+		std::cout.rdbuf(cout_buf);
+		std::cerr.rdbuf(cerr_buf);
+		throw;
+	}
+
+	std::cout.rdbuf(cout_buf);
+	std::cerr.rdbuf(cerr_buf);
+
+	r.out = out.str();
+	r.err = err.str();
+	return r;
+}
+
+// a worker process computing one task at a time
+typedef struct {
+	pid_t pid;
+	int task_fd;	// the parent sends the indices of the tasks here
+	int result_fd;	// and reads their results from here
+	int task;		// the task being computed, -1 if the worker is idle
+} worker_process;
+
+// forks a worker that computes the tasks sent to it until its task pipe is closed
+worker_process spawn_worker(const std::vector<worker_process>& workers, std::function<task_result(unsigned)>& task) {
+	int task_fds[2];
+	int result_fds[2];
+	if (pipe(task_fds) != 0) {
+		throw std::runtime_error("Unable to create a pipe for a worker process.");
+	}
+	if (pipe(result_fds) != 0) {
+		close(task_fds[0]);
+		close(task_fds[1]);
+		throw std::runtime_error("Unable to create a pipe for a worker process.");
+	}
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		close(task_fds[0]);
+		close(task_fds[1]);
+		close(result_fds[0]);
+		close(result_fds[1]);
+		throw std::runtime_error("Unable to fork a worker process.");
+	}
+
+	if (pid == 0) {
+		// worker: close the parent's ends, including those of the siblings
+		for (auto& w : workers) {
+			close(w.task_fd);
+			close(w.result_fd);
+		}
+		close(task_fds[1]);
+		close(result_fds[0]);
+
+		uint32_t i;
+		while (read_all(task_fds[0], reinterpret_cast<char*>(&i), sizeof(i))) {
+			// the inherited std::cerr may be a capture of the parent that nobody
+			// reads, so the diagnostics are sent along with the result
+			std::ostringstream log;
+			auto cerr_buf = std::cerr.rdbuf(log.rdbuf());
+
+			task_result r;
+			try {
+				r = task(i);
+			} catch (std::exception& e) {
+				r.exit_code = 3;
+				r.err = std::string(e.what()) + "\n";
+			}
+
+			std::cerr.rdbuf(cerr_buf);
+			r.log = log.str();
+
+			if (!write_result(result_fds[1], r)) {
+				break;
+			}
+		}
+
+		close(task_fds[0]);
+		close(result_fds[1]);
+		// skip the destructors and atexit handlers of the parent's state
+		_exit(0);
+	}
+
+	close(task_fds[0]);
+	close(result_fds[1]);
+	return { pid, task_fds[1], result_fds[0], -1 };
+}
+
+// closes the pipes of a worker and waits for it; a busy worker is killed
+void stop_worker(const worker_process& w) {
+	if (w.task >= 0) {
+		kill(w.pid, SIGKILL);
+	}
+	close(w.task_fd);
+	close(w.result_fd);
+	waitpid(w.pid, nullptr, 0);
+}
+
+// replaces the w-th worker, which has terminated, by a new one
+void respawn_worker(std::vector<worker_process>& workers, unsigned w, std::function<task_result(unsigned)>& task) {
+	auto dead = workers[w];
+	// the new worker must not inherit (and close) descriptors of the dead one
+	workers.erase(workers.begin() + w);
+	stop_worker(dead);
+	workers.insert(workers.begin() + w, spawn_worker(workers, task));
+}
+
+void run_in_workers(unsigned count, unsigned jobs, std::function<task_result(unsigned)> task, std::function<void(unsigned, const task_result&)> consume) {
+	if (jobs > count) {
+		jobs = count;
+	}
+
+	if (jobs <= 1) {
+		for (unsigned i = 0; i < count; ++i) {
+			consume(i, task(i));
+		}
+		return;
+	}
+
+	// the children inherit the buffers, do not let them print them twice
+	std::cout.flush();
+	std::cerr.flush();
+
+	// a worker may die before it reads its task, which must not kill us
+	auto old_sigpipe = signal(SIGPIPE, SIG_IGN);
+
+	std::vector<worker_process> workers;
+	// the results that wait for the results of the preceding tasks
+	std::map<unsigned, task_result> finished;
+	unsigned next_task = 0;
+	unsigned next_result = 0;
+
+	try {
+		for (unsigned w = 0; w < jobs; ++w) {
+			workers.push_back(spawn_worker(workers, task));
+		}
+
+		while (next_result < count) {
+			// the tasks are handed out on demand, so a slow task does not hold up the others
+			for (unsigned w = 0; w < workers.size(); ++w) {
+				while (workers[w].task < 0 && next_task < count) {
+					uint32_t i = next_task;
+					if (write_all(workers[w].task_fd, reinterpret_cast<const char*>(&i), sizeof(i))) {
+						workers[w].task = next_task++;
+					} else {
+						respawn_worker(workers, w, task);
+					}
+				}
+			}
+
+			std::vector<pollfd> busy;
+			std::vector<unsigned> busy_workers;
+			for (unsigned w = 0; w < workers.size(); ++w) {
+				if (workers[w].task >= 0) {
+					busy.push_back({ workers[w].result_fd, POLLIN, 0 });
+					busy_workers.push_back(w);
+				}
+			}
+
+			if (poll(busy.data(), busy.size(), -1) < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw std::runtime_error("Unable to wait for the worker processes.");
+			}
+
+			for (unsigned b = 0; b < busy.size(); ++b) {
+				if (busy[b].revents == 0) {
+					continue;
+				}
+
+				auto w = busy_workers[b];
+				unsigned i = workers[w].task;
+				task_result r;
+				if (read_result(workers[w].result_fd, r)) {
+					workers[w].task = -1;
+				} else {
+					// only the task of the crashed worker fails, the next ones go to a new worker
+					r.exit_code = 3;
+					r.out.clear();
+					r.err = "The worker process terminated unexpectedly.\n";
+					respawn_worker(workers, w, task);
+				}
+				finished[i] = r;
+			}
+
+			// pass the results on in the order of the input
+			for (auto it = finished.find(next_result); it != finished.end(); it = finished.find(next_result)) {
+				std::cerr << it->second.log;
+				consume(next_result, it->second);
+				finished.erase(it);
+				++next_result;
+			}
+		}
+	} catch (...) {
+		for (auto& w : workers) {
+			stop_worker(w);
+		}
+		signal(SIGPIPE, old_sigpipe);
+		throw;
+	}
+
+	for (auto& w : workers) {
+		stop_worker(w);
+	}
+	signal(SIGPIPE, old_sigpipe);
+}
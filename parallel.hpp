@@ -0,0 +1,45 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include <functional>
+#include <string>
+
+// the outcome of a task computed in a worker process
+typedef struct {
+	int exit_code;
+	std::string out;
+	std::string err;
+	// what the task wrote to std::cerr in a worker process (e.g. the -x4
+	// telemetry); the parent forwards it to its own std::cerr
+	std::string log;
+} task_result;
+
+// runs task() and collects everything it writes to std::cout and std::cerr
+task_result capture_output(std::function<int()> task);
+
+// computes task(i) for each i < count in `jobs` forked worker processes;
+// BuDDy is not thread-safe, so each worker works on its own copy of the heap
+// the tasks are handed to the workers as they become idle, a worker that
+// crashes only fails its current task and is replaced by a new one;
+// the results are passed to consume(i, result) in increasing order of i
+void run_in_workers(unsigned count, unsigned jobs, std::function<task_result(unsigned)> task, std::function<void(unsigned, const task_result&)> consume);
+
+#endif
@@ -0,0 +1,267 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <spot/parseaut/public.hh>
+#include <spot/twaalgos/dualize.hh>
+#include <spot/twaalgos/hoa.hh>
+#include <spot/twaalgos/isdet.hh>
+#include "alternating.hpp"
+#include "nondeterministic.hpp"
+#include "parallel.hpp"
+#include "portfolio.hpp"
+#include "predictor.hpp"
+#include "spotela.hpp"
+#include "utils.hpp"
+
+// the translations computed by the workers
+enum candidate_kind {
+	LTL3TELA_POS,
+	LTL3TELA_NEG,
+	SPOT_POS,
+	SPOT_NEG
+};
+
+// appends an automaton to the output of a worker as "name size\nHOA"
+void ship_automaton(std::ostream& out, const std::string& name, spot::twa_graph_ptr aut) {
+	std::ostringstream hoa;
+	spot::print_hoa(hoa, aut);
+	auto text = hoa.str();
+	out << name << ' ' << text.size() << '\n' << text;
+}
+
+// parses the automata shipped by a worker
+std::map<std::string, spot::twa_graph_ptr> receive_automata(const std::string& data, spot::bdd_dict_ptr dict) {
+	std::map<std::string, spot::twa_graph_ptr> automata;
+	std::istringstream in(data);
+
+	std::string name;
+	size_t size;
+	while (in >> name >> size && in.get() == '\n') {
+		std::string text(size, '\0');
+		in.read(&text[0], size);
+
+		spot::automaton_stream_parser parser(text.c_str(), name);
+		auto parsed = parser.parse(dict);
+		if (!parsed->aut || parsed->format_errors(std::cerr)) {
+			throw std::runtime_error("Unable to read the automaton from a worker process.");
+		}
+
+		automata[name] = parsed->aut;
+	}
+
+	return automata;
+}
+
+// computes one candidate translation in a worker process
+// besides the automaton, the worker ships its dualization (if it is
+// deterministic and comes from a negated formula) and the result of
+// SPOTELA on the automaton that build_best_nwa would simplify
+task_result run_candidate(candidate_kind kind, spot::formula f, spot::formula orig_f, spot::bdd_dict_ptr dict) {
+	std::ostringstream out;
+	bool negated = kind == LTL3TELA_NEG || kind == SPOT_NEG;
+
+	try {
+		spot::twa_graph_ptr aut;
+		if (kind == LTL3TELA_POS || kind == LTL3TELA_NEG) {
+			auto g = negated ? simplify_formula(spot::formula::Not(f)) : f;
+
+			// the workers do not know the other candidates, so there is no -k bound
+			start_candidate_budget();
+			std::unique_ptr<SLAA> slaa(make_alternating(g, dict));
+			slaa->remove_unreachable_states();
+			slaa->remove_unnecessary_marks();
+			aut = make_nondeterministic(slaa.get());
+			if (o_check_lazy) {
+				check_lazy_nondeterministic(g, dict, aut);
+			}
+		} else {
+			aut = run_ltl2tgba(negated ? spot::formula::Not(orig_f) : orig_f, dict);
+		}
+		ship_automaton(out, "nwa", aut);
+
+		if (negated) {
+			if (!spot::is_universal(aut)) {
+				return { 0, out.str(), "" };
+			}
+			aut = spot::dualize(aut);
+			ship_automaton(out, "dual", aut);
+		}
+
+		if (o_try_ltl2tgba_spotela & 2) {
+			ship_automaton(out, "spotela", spotela_simplify(aut));
+		}
+	} catch (std::runtime_error& e) {
+		std::string what(e.what());
+		if (is_budget_exceeded(e)) {
+			return { 33, "", what };
+		}
+		return { what.find("Too many acceptance sets used.") == 0 ? 32 : 3, "", what };
+	}
+
+	return { 0, out.str(), "" };
+}
+
+std::tuple<spot::twa_graph_ptr, SLAA*, std::string> build_best_nwa_portfolio(spot::formula f, spot::bdd_dict_ptr dict) {
+	bool use_ltl3tela_algorithm = !(o_debug & 2);
+	auto orig_f = f;
+	f = simplify_formula(f);
+
+	bool try_negation = o_try_negation;
+	bool try_spot = o_try_ltl2tgba_spotela & 1;
+	prescreen_candidates(f, use_ltl3tela_algorithm, try_negation, try_spot);
+
+	std::vector<candidate_kind> candidates;
+	if (use_ltl3tela_algorithm) {
+		candidates.push_back(LTL3TELA_POS);
+		if (try_negation) {
+			candidates.push_back(LTL3TELA_NEG);
+		}
+	}
+	if (try_spot) {
+		candidates.push_back(SPOT_POS);
+		if (try_negation) {
+			candidates.push_back(SPOT_NEG);
+		}
+	}
+
+	// the parsed automata need a dictionary even if the caller has none
+	auto parse_dict = dict ? dict : spot::make_bdd_dict();
+
+	std::map<candidate_kind, task_result> results;
+	run_in_workers(candidates.size(), candidates.size(),
+		[&](unsigned i) {
+			return run_candidate(candidates[i], f, orig_f, dict);
+		},
+		[&](unsigned i, const task_result& r) {
+			results[candidates[i]] = r;
+		}
+	);
+
+	// the results of SPOTELA computed by the workers, by their input automaton
+	std::map<spot::twa_graph_ptr, spot::twa_graph_ptr> spotela_of;
+	std::map<candidate_kind, std::map<std::string, spot::twa_graph_ptr>> automata;
+	for (auto& rec : results) {
+		if (rec.second.exit_code == 0) {
+			auto& a = automata[rec.first] = receive_automata(rec.second.out, parse_dict);
+			if (a.count("spotela") > 0) {
+				spotela_of[a.count("dual") > 0 ? a["dual"] : a["nwa"]] = a["spotela"];
+			}
+		}
+	}
+
+	auto get_spotela = [&](spot::twa_graph_ptr aut) {
+		auto it = spotela_of.find(aut);
+		return it != spotela_of.end() ? it->second : spotela_simplify(aut);
+	};
+
+	// returns false if the candidate crashed on too many marks
+	// or exceeded its budget
+	auto succeeded = [&](candidate_kind kind) {
+		auto& r = results[kind];
+		if (r.exit_code == 32 || r.exit_code == 33) {
+			return false;
+		} else if (r.exit_code != 0) {
+			throw std::runtime_error(r.err);
+		}
+		return true;
+	};
+
+	// from now on, replay the choices of build_best_nwa
+	spot::twa_graph_ptr nwa = nullptr;
+	std::string stats("basic");
+	bool we_crashed = false;
+
+	for (auto kind : { LTL3TELA_POS, LTL3TELA_NEG }) {
+		if (results.count(kind) == 0) {
+			continue;
+		}
+
+		if (!succeeded(kind)) {
+			// a negated candidate over its budget is simply dropped
+			we_crashed = we_crashed || kind == LTL3TELA_POS || results[kind].exit_code == 32;
+			continue;
+		}
+
+		auto& a = automata[kind];
+		if (kind == LTL3TELA_POS) {
+			nwa = a["nwa"];
+		} else if (a.count("dual") > 0) {
+			if (we_crashed) {
+				// the positive candidate failed, the complement is all we have
+				nwa = a["dual"];
+				stats = "neg";
+				we_crashed = false;
+			} else {
+				std::tie(nwa, stats) = compare_automata(nwa, a["dual"], stats, "neg");
+			}
+		}
+
+		if ((o_try_ltl2tgba_spotela & 2) && !we_crashed) {
+			std::tie(nwa, stats) = compare_automata(nwa, get_spotela(nwa), stats, stats + "+spotela");
+		}
+	}
+
+	if (try_spot) {
+		spot::twa_graph_ptr nwa_spot;
+		std::string stats_spot("spot");
+
+		for (auto kind : { SPOT_POS, SPOT_NEG }) {
+			if (results.count(kind) == 0) {
+				continue;
+			}
+
+			if (!succeeded(kind)) {
+				throw std::runtime_error(results[kind].err);
+			}
+
+			auto& a = automata[kind];
+			if (kind == SPOT_POS) {
+				nwa_spot = a["nwa"];
+			} else if (a.count("dual") > 0) {
+				std::tie(nwa_spot, stats_spot) = compare_automata(nwa_spot, a["dual"], stats_spot, "spotneg");
+			}
+		}
+
+		if (o_try_ltl2tgba_spotela & 2) {
+			std::tie(nwa_spot, stats_spot) = compare_automata(nwa_spot, get_spotela(nwa_spot), stats_spot, stats_spot + "+spotela");
+		}
+
+		if (we_crashed || !use_ltl3tela_algorithm) {
+			nwa = nwa_spot;
+			stats = stats_spot;
+		} else {
+			std::tie(nwa, stats) = compare_automata(nwa, nwa_spot, stats, stats_spot);
+		}
+	}
+
+	if (!nwa) {
+		// every candidate ran out of its budget, Spot has none
+		nwa = run_ltl2tgba(orig_f, dict);
+		stats = "spot";
+	}
+
+	stats += "\n";
+
+	return std::make_tuple(nwa, nullptr, stats);
+}
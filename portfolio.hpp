@@ -0,0 +1,37 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+#include <string>
+#include <tuple>
+#include <spot/tl/formula.hh>
+#include <spot/twa/bdddict.hh>
+#include <spot/twa/twagraph.hh>
+
+class SLAA;
+
+// does the same as build_best_nwa, but translates f and !f by LTL3TELA
+// and by Spot in parallel worker processes (-P flag)
+// the automata are passed back in HOA and compared in the same order
+// as in build_best_nwa, so the result does not depend on timing
+// the SLAA is never returned
+std::tuple<spot::twa_graph_ptr, SLAA*, std::string> build_best_nwa_portfolio(spot::formula f, spot::bdd_dict_ptr dict);
+
+#endif
@@ -0,0 +1,285 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <spot/tl/parse.hh>
+#include "alternating.hpp"
+#include "predictor.hpp"
+#include "utils.hpp"
+
+// the wins of { LTL3TELA, Spot } for each class of features, see feature_class
+std::map<std::string, std::pair<unsigned, unsigned>> prediction_table;
+
+// the number of formulae in a class needed to trust the table
+const unsigned prediction_table_min_samples = 5;
+
+bool is_temporal(spot::formula f) {
+	return f.is(spot::op::X, spot::op::F, spot::op::G) || f.is(spot::op::U, spot::op::R) || f.is(spot::op::W, spot::op::M);
+}
+
+bool is_until_like(spot::formula f) {
+	return (f.is(spot::op::U, spot::op::R) || f.is(spot::op::W, spot::op::M)) && !f[0].is_tt() && !f[0].is_ff();
+}
+
+unsigned temporal_depth(spot::formula f) {
+	unsigned depth = 0;
+	for (auto g : f) {
+		depth = std::max(depth, temporal_depth(g));
+	}
+	return depth + (is_temporal(f) ? 1 : 0);
+}
+
+unsigned until_depth(spot::formula f) {
+	unsigned depth = 0;
+	for (auto g : f) {
+		depth = std::max(depth, until_depth(g));
+	}
+	return depth + (is_until_like(f) ? 1 : 0);
+}
+
+unsigned until_under_g_depth(spot::formula f) {
+	if (f.is(spot::op::G)) {
+		return until_depth(f[0]);
+	}
+
+	if (f.is(spot::op::R) && f[0].is_ff()) {
+		return until_depth(f[1]);
+	}
+
+	unsigned depth = 0;
+	for (auto g : f) {
+		depth = std::max(depth, until_under_g_depth(g));
+	}
+	return depth;
+}
+
+formula_features get_formula_features(spot::formula f) {
+	formula_features ff;
+
+	ff.suspendable = false;
+	f.traverse([&](spot::formula g) {
+		ff.suspendable = ff.suspendable || is_suspendable(g);
+		return ff.suspendable || g.is_boolean();
+	});
+
+	ff.temporal_depth = temporal_depth(f);
+	ff.u_under_g = until_under_g_depth(f);
+	ff.max_u_disj_size = get_max_u_disj_size(f);
+
+	if (f.is_syntactic_safety()) {
+		ff.syntactic_class = 'S';
+	} else if (f.is_syntactic_guarantee()) {
+		ff.syntactic_class = 'G';
+	} else if (f.is_syntactic_obligation()) {
+		ff.syntactic_class = 'O';
+	} else if (f.is_syntactic_recurrence()) {
+		ff.syntactic_class = 'R';
+	} else if (f.is_syntactic_persistence()) {
+		ff.syntactic_class = 'P';
+	} else {
+		ff.syntactic_class = 'A';
+	}
+
+	return ff;
+}
+
+// the features that the prediction table distinguishes
+std::string feature_class(const formula_features& ff) {
+	std::ostringstream key;
+	key << ff.syntactic_class << ff.suspendable << std::min(ff.u_under_g, 2u) << std::min(ff.max_u_disj_size, 3u);
+	return key.str();
+}
+
+candidate_prediction predict_candidates(spot::formula f) {
+	auto ff = get_formula_features(f);
+	candidate_prediction p;
+
+	// the dual of !f is only used if it is deterministic, which is
+	// likely when !f is a guarantee formula
+	p.negation = o_deterministic || ff.syntactic_class == 'S' || ff.syntactic_class == 'O';
+
+	auto rec = prediction_table.find(feature_class(ff));
+	if (rec != prediction_table.end() && rec->second.first + rec->second.second >= prediction_table_min_samples) {
+		auto wins_ltl3tela = rec->second.first;
+		auto wins_spot = rec->second.second;
+
+		p.ltl3tela = wins_ltl3tela * 2 > wins_spot;
+		p.spot = wins_spot * 2 > wins_ltl3tela;
+		p.confident = true;
+		return p;
+	}
+
+	// LTL3TELA profits from the suspension and the U-merging,
+	// while U nested below G blows up its SLAA
+	bool favours_ltl3tela = ff.suspendable || ff.max_u_disj_size > 1;
+	bool favours_spot = ff.u_under_g > 1 || ff.temporal_depth > 4;
+
+	p.confident = favours_ltl3tela != favours_spot;
+	p.ltl3tela = !p.confident || favours_ltl3tela;
+	p.spot = p.confident && favours_spot;
+	return p;
+}
+
+// splits a line of CSV into fields, "" inside a quoted field is "
+std::vector<std::string> split_csv_line(const std::string& line) {
+	std::vector<std::string> fields(1);
+	bool quoted = false;
+
+	for (unsigned i = 0; i < line.size(); ++i) {
+		char c = line[i];
+		if (quoted) {
+			if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+				fields.back() += '"';
+				++i;
+			} else if (c == '"') {
+				quoted = false;
+			} else {
+				fields.back() += c;
+			}
+		} else if (c == '"') {
+			quoted = true;
+		} else if (c == ',') {
+			fields.emplace_back();
+		} else if (c != '\r') {
+			fields.back() += c;
+		}
+	}
+
+	return fields;
+}
+
+// returns the tool of the table that stands for the given translator: the tool
+// of the same name, or its only variant (like ltl3tela-D1 in det.rand.csv)
+std::string pick_table_tool(const std::set<std::string>& tools, const std::string& name) {
+	if (tools.count(name) > 0) {
+		return name;
+	}
+
+	std::vector<std::string> variants;
+	for (auto& tool : tools) {
+		if (tool.compare(0, name.size() + 1, name + "-") == 0) {
+			variants.push_back(tool);
+		}
+	}
+
+	if (variants.empty()) {
+		throw std::runtime_error("The prediction table has no results of " + name + ".");
+	} else if (variants.size() > 1) {
+		throw std::runtime_error("The prediction table has several variants of " + name + ".");
+	}
+	return variants[0];
+}
+
+void load_prediction_table(const std::string& file_name) {
+	std::ifstream file(file_name);
+	std::string line;
+
+	if (!file || !std::getline(file, line)) {
+		throw std::runtime_error("Unable to read the prediction table " + file_name + ".");
+	}
+
+	auto header = split_csv_line(line);
+	auto column = [&](const std::string& name) {
+		auto it = std::find(header.begin(), header.end(), name);
+		if (it == header.end()) {
+			throw std::runtime_error("The prediction table has no column " + name + ".");
+		}
+		return unsigned(it - header.begin());
+	};
+
+	auto formula_col = column("formula");
+	auto tool_col = column("tool");
+	auto status_col = column("exit_status");
+	auto states_col = column("states");
+
+	std::vector<std::vector<std::string>> rows;
+	std::set<std::string> tools;
+	while (std::getline(file, line)) {
+		auto fields = split_csv_line(line);
+		if (fields.size() >= header.size()) {
+			tools.insert(fields[tool_col]);
+			rows.push_back(std::move(fields));
+		}
+	}
+
+	auto tool_ltl3tela = pick_table_tool(tools, "ltl3tela");
+	auto tool_spot = pick_table_tool(tools, "ltl2tgba");
+
+	// the number of states of { LTL3TELA, Spot } for each formula
+	std::map<std::string, std::pair<unsigned, unsigned>> results;
+
+	for (auto& fields : rows) {
+		if (fields[status_col] != "ok") {
+			continue;
+		}
+
+		auto& rec = results.emplace(fields[formula_col], std::make_pair(0u, 0u)).first->second;
+		if (fields[tool_col] == tool_ltl3tela) {
+			rec.first = std::stoi(fields[states_col]);
+		} else if (fields[tool_col] == tool_spot) {
+			rec.second = std::stoi(fields[states_col]);
+		}
+	}
+
+	for (auto& rec : results) {
+		auto states_ltl3tela = rec.second.first;
+		auto states_spot = rec.second.second;
+		if (states_ltl3tela == 0 || states_spot == 0 || states_ltl3tela == states_spot) {
+			continue;
+		}
+
+		spot::formula f;
+		try {
+			f = simplify_formula(spot::parse_formula(rec.first));
+		} catch (spot::parse_error&) {
+			continue;
+		}
+
+		auto& wins = prediction_table[feature_class(get_formula_features(f))];
+		if (states_ltl3tela < states_spot) {
+			++wins.first;
+		} else {
+			++wins.second;
+		}
+	}
+}
+
+void prescreen_candidates(spot::formula f, bool& use_ltl3tela, bool& try_negation, bool& try_spot) {
+	// -x2 has chosen the translator already
+	if (o_prescreen == 0 || !use_ltl3tela) {
+		return;
+	}
+
+	auto p = predict_candidates(f);
+	if (!p.confident && o_prescreen == 2) {
+		// fall back to all the candidates
+		return;
+	}
+
+	// keep LTL3TELA if it is the only translator allowed
+	use_ltl3tela = p.ltl3tela || !try_spot;
+	try_spot = try_spot && p.spot;
+	try_negation = try_negation && p.negation;
+}
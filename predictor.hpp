@@ -0,0 +1,67 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+#include <string>
+#include <spot/tl/formula.hh>
+
+// features of a formula used to predict which translations
+// of build_best_nwa are worth running (-z)
+typedef struct {
+	// some subformula is suspendable
+	bool suspendable;
+	// the nesting depth of temporal operators
+	unsigned temporal_depth;
+	// the nesting depth of U, R, W and M below some G
+	unsigned u_under_g;
+	// the largest f_bar size of the right operand of an U
+	unsigned max_u_disj_size;
+	// the syntactic class in the Manna-Pnueli hierarchy:
+	// 'S'afety, 'G'uarantee, 'O'bligation, 'R'ecurrence, 'P'ersistence, 'A'ny
+	char syntactic_class;
+} formula_features;
+
+// the translations of build_best_nwa predicted to be worth running
+typedef struct {
+	bool ltl3tela;
+	bool spot;
+	bool negation;
+	// false if the features did not point to one translator;
+	// LTL3TELA alone is predicted then
+	bool confident;
+} candidate_prediction;
+
+formula_features get_formula_features(spot::formula f);
+
+candidate_prediction predict_candidates(spot::formula f);
+
+// loads the results of ltl3tela and ltl2tgba from a CSV file produced
+// by the experiments (columns formula, tool, exit_status and states);
+// a tool may also be named by its only variant, like ltl3tela-D1;
+// the prediction then follows the translator that produced fewer states
+// for the formulae with the same features
+// throws a runtime_error if the file cannot be read or lacks one of the tools
+void load_prediction_table(const std::string& file_name);
+
+// turns off the candidates of build_best_nwa not worth running
+// according to -z; never turns on a candidate disabled by the options
+void prescreen_candidates(spot::formula f, bool& use_ltl3tela, bool& try_negation, bool& try_spot);
+
+#endif
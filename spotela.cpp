@@ -19,6 +19,7 @@
 */
 
 #include "spotela.hpp"
+#include "telemetry.hpp"
 
 std::vector<edge_t> get_loops(spot::twa_graph_ptr aut, unsigned state) {
 	std::vector<edge_t> loops;
@@ -40,15 +41,41 @@ std::vector<edge_t> out_edges(spot::twa_graph_ptr aut, unsigned state1, unsigned
 	return edges;
 }
 
-std::vector<edge_t> in_edges(spot::twa_graph_ptr aut, unsigned state1, unsigned state2) {
-	std::vector<edge_t> edges;
+predecessor_index build_predecessor_index(spot::twa_graph_ptr aut) {
+	predecessor_index preds(aut->num_states());
 	for (unsigned s = 0, ns = aut->num_states(); s < ns; ++s) {
 		for (auto& edge : aut->out(s)) {
-			if (edge.src != state1 && edge.src != state2 && edge.dst == state1) {
-				edges.push_back(edge);
-			}
+			preds[edge.dst].push_back(aut->edge_number(edge));
+		}
+	}
+
+	// out(s) lists the edges of s in the order of creation
+	for (auto& p : preds) {
+		std::sort(p.begin(), p.end());
+	}
+	return preds;
+}
+
+// creates an edge and registers it in the predecessor index
+unsigned new_indexed_edge(spot::twa_graph_ptr aut, predecessor_index& preds, unsigned src, unsigned dst, bdd cond, spot::acc_cond::mark_t acc) {
+	unsigned e = aut->new_edge(src, dst, cond, acc);
+	preds[dst].push_back(e);
+	return e;
+}
+
+std::vector<edge_t> in_edges(spot::twa_graph_ptr aut, const predecessor_index& preds, unsigned state1, unsigned state2) {
+	std::vector<edge_t> edges;
+	for (auto e : preds[state1]) {
+		auto& edge = aut->edge_storage(e);
+		if (edge.src != state1 && edge.src != state2) {
+			edges.push_back(edge);
 		}
 	}
+
+	// keep the order of a scan over the sources
+	std::stable_sort(edges.begin(), edges.end(), [](const edge_t& e1, const edge_t& e2) {
+		return e1.src < e2.src;
+	});
 	return edges;
 }
 
@@ -73,9 +100,9 @@ maybe<std::vector<edge_t>> check_out_edges(spot::twa_graph_ptr aut, unsigned sta
 	return maybe<std::vector<edge_t>>::just(s1_edges);
 }
 
-maybe<std::vector<edge_t>> check_in_edges(spot::twa_graph_ptr aut, unsigned state1, unsigned state2) {
-	auto s1_edges = in_edges(aut, state1, state2);
-	auto s2_edges = in_edges(aut, state2, state1);
+maybe<std::vector<edge_t>> check_in_edges(spot::twa_graph_ptr aut, const predecessor_index& preds, unsigned state1, unsigned state2) {
+	auto s1_edges = in_edges(aut, preds, state1, state2);
+	auto s2_edges = in_edges(aut, preds, state2, state1);
 
 	for (auto& edge2 : s2_edges) {
 		bool any = false;
@@ -135,42 +162,79 @@ maybe<bdd> get_connecting_edge_condition(spot::twa_graph_ptr aut, unsigned state
 	return maybe<bdd>::just(cond);
 }
 
-spot::twa_graph_ptr build_simplified_automaton(spot::twa_graph_ptr aut, unsigned base_state, std::vector<state_info> state_infos) {
-	std::vector<unsigned> states;
-	for (auto& si : state_infos) {
-		states.push_back(si.state);
+// builds the simplified automaton together with its predecessor index, which replaces preds;
+// every group collapses its base state with the states of its state_infos
+spot::twa_graph_ptr build_simplified_automaton(spot::twa_graph_ptr aut, predecessor_index& preds, inclusion_oracle& oracle, std::vector<simplification_group> groups) {
+	std::vector<std::vector<unsigned>> group_states;
+	std::vector<unsigned> all_states;
+	for (auto& group : groups) {
+		std::vector<unsigned> states;
+		for (auto& si : group.state_infos) {
+			states.push_back(si.state);
+		}
+		states.push_back(group.base_state);
+		all_states.insert(std::end(all_states), std::begin(states), std::end(states));
+		group_states.push_back(states);
 	}
-	states.push_back(base_state);
+
+	// only the languages of states reaching the collapsed ones may change
+	auto affected = states_reaching(aut, preds, all_states);
 
 	spot::twa_graph_ptr new_aut;
-	unsigned new_state;
+	std::vector<unsigned> new_states;
 	std::vector<unsigned> state_v;
-	std::tie(new_aut, new_state, state_v) = copy_aut(aut, states);
-
-	auto si_size = state_infos.size();
-	auto fin_marks = set_fin_cond(new_aut, si_size);
+	std::tie(new_aut, new_states, state_v) = copy_aut(aut, preds, group_states);
+	remap_inclusion_oracle(oracle, affected, state_v);
+
+	for (unsigned g = 0; g < groups.size(); ++g) {
+		auto& state_infos = groups[g].state_infos;
+		auto new_state = new_states[g];
+		auto si_size = state_infos.size();
+		auto fin_marks = set_fin_cond(new_aut, si_size);
+
+		for (unsigned i = 0; i < si_size; ++i) {
+			std::vector<unsigned> fin_marks_minus_ith;
+			std::copy_if(std::begin(fin_marks), std::end(fin_marks), std::back_inserter(fin_marks_minus_ith),
+				[&fin_marks, i](unsigned j) { return fin_marks[i] != j; });
+			add_edges(new_aut, preds, state_infos[i], new_state, state_v, fin_marks_minus_ith);
+		}
 
-	for (unsigned i = 0; i < si_size; ++i) {
-		std::vector<unsigned> fin_marks_minus_ith;
-		std::copy_if(std::begin(fin_marks), std::end(fin_marks), std::back_inserter(fin_marks_minus_ith),
-			[&fin_marks, i](unsigned j) { return fin_marks[i] != j; });
-		add_edges(new_aut, state_infos[i], new_state, state_v, fin_marks_minus_ith);
+		new_indexed_edge(new_aut, preds, new_state, new_state, state_infos[0].b.cond,
+			spot::acc_cond::mark_t(std::begin(fin_marks), std::end(fin_marks)));
 	}
-
-	new_aut->new_edge(new_state, new_state, state_infos[0].b.cond,
-		spot::acc_cond::mark_t(std::begin(fin_marks), std::end(fin_marks)));
 	return new_aut;
 }
 
-spot::twa_graph_ptr simplify_one_scc(spot::twa_graph_ptr aut) {
+// marks the states of a group and all their neighbours
+void block_neighbourhood(spot::twa_graph_ptr aut, const predecessor_index& preds, std::vector<bool>& blocked, const std::vector<unsigned>& states) {
+	for (auto state : states) {
+		blocked[state] = true;
+		for (auto& edge : aut->out(state)) {
+			blocked[edge.dst] = true;
+		}
+		for (auto edge_num : preds[state]) {
+			blocked[aut->edge_storage(edge_num).src] = true;
+		}
+	}
+}
+
+// applies every reduction found in one pass over the SCCs at once; two groups are
+// only applied together if no state of one is adjacent to a state of the other
+spot::twa_graph_ptr simplify_sccs(spot::twa_graph_ptr aut, predecessor_index& preds, inclusion_oracle& oracle) {
 	spot::scc_info si(aut);
+	std::vector<bool> blocked(aut->num_states(), false);
+	std::vector<simplification_group> groups;
 	for (int scc = si.scc_count() - 1; scc >= 0; --scc) {
 		std::vector<state_info> states;
 		auto state_of_scc = si.one_state_of(scc);
+		if (blocked[state_of_scc]) {
+			continue;
+		}
+
 		if (is_one_state_scc(si, scc) && has_successors(si, scc) && si.is_rejecting_scc(scc)) {
 			for (auto& succ : si.succ(scc)) {
 				if (is_one_state_scc(si, succ) && si.is_accepting_scc(succ)) {
-					auto simpl_state = check_simplifiability(aut, state_of_scc, si.states_of(succ)[0]);
+					auto simpl_state = check_simplifiability(aut, preds, oracle, state_of_scc, si.states_of(succ)[0]);
 					if (simpl_state.isJust()) {
 						states.push_back(simpl_state.fromJust());
 					}
@@ -179,42 +243,294 @@ spot::twa_graph_ptr simplify_one_scc(spot::twa_graph_ptr aut) {
 		}
 
 		if (!states.empty()) {
-			return build_simplified_automaton(aut, state_of_scc, states);
+			std::vector<unsigned> group_states = { state_of_scc };
+			for (auto& s : states) {
+				group_states.push_back(s.state);
+			}
+
+			if (std::none_of(std::begin(group_states), std::end(group_states), [&blocked](unsigned s) { return blocked[s]; })) {
+				block_neighbourhood(aut, preds, blocked, group_states);
+				groups.push_back({ state_of_scc, states });
+			}
 		}
 	}
 
-	return aut;
+	if (groups.empty()) {
+		return aut;
+	}
+	return build_simplified_automaton(aut, preds, oracle, groups);
 }
 
 spot::twa_graph_ptr spotela_simplify(spot::twa_graph_ptr aut) {
+	phase_telemetry telemetry("spotela_simplify");
+
+	auto input = aut;
 	if (!aut->acc().is_generalized_buchi()) {
-		// the algorithm only works for (T)GBA
-		return aut;
+		// the Emerson-Lei automata are reduced only if their condition
+		// simplifies to a disjunction of generalized Büchi conditions
+		aut = spot::cleanup_acceptance(aut);
+		if (aut->acc().uses_fin_acceptance()) {
+			return input;
+		}
 	}
 
-	auto aut2 = simplify_one_scc(aut);
+	// the index and the oracle are built once and then maintained
+	// by build_simplified_automaton
+	auto preds = build_predecessor_index(aut);
+	inclusion_oracle oracle = inclusion_oracle();
+	unsigned passes = 1;
+	auto aut2 = simplify_sccs(aut, preds, oracle);
 	while (aut2->num_states() < aut->num_states()) {
 		aut = aut2;
-		aut2 = simplify_one_scc(aut);
+		aut2 = simplify_sccs(aut, preds, oracle);
+		++passes;
+	}
+
+	if (passes == 1 && aut2 == aut) {
+		// nothing was collapsed, do not return the cleaned up acceptance
+		aut2 = input;
 	}
 
+	telemetry.count("na_states", aut2->num_states());
+	telemetry.count("na_edges", aut2->num_edges());
+	telemetry.count("passes", passes);
+	telemetry.count("inclusion_cached", oracle.cached_answers);
+	telemetry.count("inclusion_successors", oracle.successor_answers);
+	telemetry.count("inclusion_simulation", oracle.simulation_answers);
+	telemetry.count("inclusion_contains", oracle.contains_answers);
+	telemetry.count("simulation_pair_checks", oracle.simulation_pair_checks);
+	telemetry.count("simulation_ms", unsigned(oracle.simulation_seconds * 1000));
+	telemetry.count("contains_ms", unsigned(oracle.contains_seconds * 1000));
+
 	return aut2;
 }
 
-bool implies_language(spot::twa_graph_ptr aut, unsigned state1, unsigned state2) {
-	// check L(A1) ⊆ L(A2)
-	auto aut1 = create_aut_from_state(aut, state1);
-	auto aut2 = create_aut_from_state(aut, state2);
+// returns the automaton of the state, building it only once
+spot::twa_graph_ptr get_state_aut(spot::twa_graph_ptr aut, inclusion_oracle& oracle, unsigned state) {
+	auto it = oracle.state_auts.find(state);
+	if (it == oracle.state_auts.end()) {
+		it = oracle.state_auts.emplace(state, create_aut_from_state(aut, state)).first;
+	}
+	return it->second;
+}
+
+// the direct simulation is not computed for larger automata
+const unsigned max_simulation_states = 300;
+
+bool implies_language(spot::twa_graph_ptr aut, inclusion_oracle& oracle, unsigned state1, unsigned state2) {
+	// check L(A1) ⊆ L(A2), trying the cheap sufficient conditions first
+	auto key = std::make_pair(state1, state2);
+	auto it = oracle.results.find(key);
+	if (it != oracle.results.end()) {
+		++oracle.cached_answers;
+		return it->second;
+	}
+
+	bool result;
+	if (state1 == state2 || covered_by_same_successors(aut, state1, state2)) {
+		++oracle.successor_answers;
+		result = true;
+	} else {
+		if (!oracle.simulation_computed) {
+			if (aut->num_states() <= max_simulation_states) {
+				auto start = std::chrono::steady_clock::now();
+				oracle.simulated_by = compute_direct_simulation(aut, oracle.simulation_pair_checks);
+				oracle.simulation_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+			oracle.simulation_computed = true;
+		}
+
+		if (!oracle.simulated_by.empty() && oracle.simulated_by[state1][state2]) {
+			++oracle.simulation_answers;
+			result = true;
+		} else {
+			++oracle.contains_answers;
+			auto start = std::chrono::steady_clock::now();
+			result = spot::contains(get_state_aut(aut, oracle, state1), get_state_aut(aut, oracle, state2));
+			oracle.contains_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	oracle.results[key] = result;
+	return result;
+}
+
+// checks whether an edge with marks acc2 is at least as good as one with acc1
+// (more Inf-marks and fewer Fin-marks); inf_fin comes from used_inf_fin_sets
+bool mark_dominated(const std::pair<spot::acc_cond::mark_t, spot::acc_cond::mark_t>& inf_fin, spot::acc_cond::mark_t acc1, spot::acc_cond::mark_t acc2) {
+	return (acc1 & inf_fin.first).subset(acc2) && (acc2 & inf_fin.second).subset(acc1);
+}
+
+// checks whether each edge of state1 is covered by edges of state2 leading
+// to the same state with at least as good marks; then L(state1) ⊆ L(state2)
+bool covered_by_same_successors(spot::twa_graph_ptr aut, unsigned state1, unsigned state2) {
+	auto inf_fin = aut->acc().get_acceptance().used_inf_fin_sets();
+
+	for (auto& e1 : aut->out(state1)) {
+		bdd covered = bddfalse;
+		for (auto& e2 : aut->out(state2)) {
+			if (e1.dst == e2.dst && mark_dominated(inf_fin, e1.acc, e2.acc)) {
+				covered = bdd_or(covered, e2.cond);
+			}
+		}
+
+		if (!bdd_implies(e1.cond, covered)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// checks whether q covers the edges of p: each letter read by an edge of p
+// can be read by an edge of q with at least as good marks leading to a state
+// simulating the target of p's edge
+bool simulation_step_holds(spot::twa_graph_ptr aut, const std::pair<spot::acc_cond::mark_t, spot::acc_cond::mark_t>& inf_fin, const std::vector<std::vector<bool>>& simulated_by, unsigned p, unsigned q) {
+	for (auto& e1 : aut->out(p)) {
+		bdd covered = bddfalse;
+		for (auto& e2 : aut->out(q)) {
+			if (simulated_by[e1.dst][e2.dst] && mark_dominated(inf_fin, e1.acc, e2.acc)) {
+				covered = bdd_or(covered, e2.cond);
+			}
+		}
+
+		if (!bdd_implies(e1.cond, covered)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// computes the direct simulation as the greatest fixpoint of simulation_step_holds;
+// once a pair is refuted, only the pairs of its predecessors are checked again
+std::vector<std::vector<bool>> compute_direct_simulation(spot::twa_graph_ptr aut, unsigned& pair_checks) {
+	auto n = aut->num_states();
+	auto inf_fin = aut->acc().get_acceptance().used_inf_fin_sets();
+	std::vector<std::vector<bool>> simulated_by(n, std::vector<bool>(n, true));
+
+	std::vector<std::vector<unsigned>> sources(n);
+	for (auto& edge : aut->edges()) {
+		if (sources[edge.dst].empty() || sources[edge.dst].back() != edge.src) {
+			sources[edge.dst].push_back(edge.src);
+		}
+	}
+
+	std::vector<std::pair<unsigned, unsigned>> worklist;
+	std::vector<std::vector<bool>> queued(n, std::vector<bool>(n, false));
+	for (unsigned p = 0; p < n; ++p) {
+		for (unsigned q = 0; q < n; ++q) {
+			if (p != q) {
+				worklist.emplace_back(p, q);
+				queued[p][q] = true;
+			}
+		}
+	}
 
-	return spot::contains(aut1, aut2);
+	while (!worklist.empty()) {
+		unsigned p, q;
+		std::tie(p, q) = worklist.back();
+		worklist.pop_back();
+		queued[p][q] = false;
+
+		++pair_checks;
+		if (simulation_step_holds(aut, inf_fin, simulated_by, p, q)) {
+			continue;
+		}
+
+		simulated_by[p][q] = false;
+		for (auto p2 : sources[p]) {
+			for (auto q2 : sources[q]) {
+				if (p2 != q2 && simulated_by[p2][q2] && !queued[p2][q2]) {
+					worklist.emplace_back(p2, q2);
+					queued[p2][q2] = true;
+				}
+			}
+		}
+	}
+
+	return simulated_by;
 }
 
-maybe<edge_t> check_snd_pattern(spot::twa_graph_ptr aut, edge_t edge, bdd c_edge_cond, unsigned state1, unsigned state2) {
+// returns the states from which some of the given states are reachable
+std::vector<bool> states_reaching(spot::twa_graph_ptr aut, const predecessor_index& preds, const std::vector<unsigned>& states) {
+	std::vector<bool> reaching(aut->num_states(), false);
+	std::vector<unsigned> stack;
+
+	for (auto s : states) {
+		reaching[s] = true;
+		stack.push_back(s);
+	}
+
+	while (!stack.empty()) {
+		auto s = stack.back();
+		stack.pop_back();
+
+		for (auto e : preds[s]) {
+			auto src = aut->edge_storage(e).src;
+			if (!reaching[src]) {
+				reaching[src] = true;
+				stack.push_back(src);
+			}
+		}
+	}
+
+	return reaching;
+}
+
+// moves the entries of the unaffected states to their numbers in the new
+// automaton (states_v, see copy_aut) and drops the others; the unaffected
+// states reach only copied edges, so their languages stay the same
+void remap_inclusion_oracle(inclusion_oracle& oracle, const std::vector<bool>& affected, const std::vector<unsigned>& states_v) {
+	inclusion_oracle remapped = inclusion_oracle();
+	remapped.cached_answers = oracle.cached_answers;
+	remapped.successor_answers = oracle.successor_answers;
+	remapped.simulation_answers = oracle.simulation_answers;
+	remapped.contains_answers = oracle.contains_answers;
+	remapped.simulation_pair_checks = oracle.simulation_pair_checks;
+	remapped.simulation_seconds = oracle.simulation_seconds;
+	remapped.contains_seconds = oracle.contains_seconds;
+
+	// the simulation between the unaffected states stays the same; the pairs
+	// with an affected state are left unknown (false) rather than recomputed
+	if (!oracle.simulated_by.empty()) {
+		unsigned new_count = 0;
+		for (auto s : states_v) {
+			new_count = std::max(new_count, s + 1);
+		}
+
+		remapped.simulated_by.assign(new_count, std::vector<bool>(new_count, false));
+		for (unsigned p = 0; p < states_v.size(); ++p) {
+			for (unsigned q = 0; q < states_v.size(); ++q) {
+				if (!affected[p] && !affected[q] && oracle.simulated_by[p][q]) {
+					remapped.simulated_by[states_v[p]][states_v[q]] = true;
+				}
+			}
+		}
+		remapped.simulation_computed = true;
+	}
+
+	for (auto& rec : oracle.state_auts) {
+		if (!affected[rec.first]) {
+			remapped.state_auts[states_v[rec.first]] = rec.second;
+		}
+	}
+
+	for (auto& rec : oracle.results) {
+		if (!affected[rec.first.first] && !affected[rec.first.second]) {
+			remapped.results[std::make_pair(states_v[rec.first.first], states_v[rec.first.second])] = rec.second;
+		}
+	}
+
+	oracle = std::move(remapped);
+}
+
+maybe<edge_t> check_snd_pattern(spot::twa_graph_ptr aut, inclusion_oracle& oracle, edge_t edge, bdd c_edge_cond, unsigned state1, unsigned state2) {
 	auto oe = out_edges(aut, state1, state1);
 	auto condition = bdd_and(edge.cond, bdd_not(c_edge_cond));
 
 	for (auto& e : oe) {
-		if (bdd_implies(condition, e.cond) && implies_language(aut, state2, e.dst)) {
+		if (bdd_implies(condition, e.cond) && implies_language(aut, oracle, state2, e.dst)) {
 			return maybe<edge_t>::just(e);
 		}
 	}
@@ -222,69 +538,89 @@ maybe<edge_t> check_snd_pattern(spot::twa_graph_ptr aut, edge_t edge, bdd c_edge
 	return maybe<edge_t>::nothing();
 }
 
-std::tuple<spot::twa_graph_ptr, unsigned, std::vector<unsigned>> copy_aut(spot::twa_graph_ptr aut, std::vector<unsigned> states) {
-	if (states.empty()) {
-		throw "copy_aut: states vector is not expected to be empty.";
-	}
+// copies aut with the states of every group collapsed to one (the smallest of them);
+// preds becomes the index of the copy and the new states follow the order of the groups
+std::tuple<spot::twa_graph_ptr, std::vector<unsigned>, std::vector<unsigned>> copy_aut(spot::twa_graph_ptr aut, predecessor_index& preds, std::vector<std::vector<unsigned>> groups) {
+	auto ns = aut->num_states();
+	// group_of[s] is the group collapsing s, or -1
+	std::vector<int> group_of(ns, -1);
+	std::vector<unsigned> representatives;
+	unsigned collapsed = 0;
+	for (unsigned g = 0; g < groups.size(); ++g) {
+		if (groups[g].empty()) {
+			throw "copy_aut: states vector is not expected to be empty.";
+		}
 
-	unsigned new_state = *(std::min_element(std::begin(states), std::end(states)));
-	unsigned init_state = aut->get_init_state_number();
+		for (auto state : groups[g]) {
+			group_of[state] = g;
+		}
+		representatives.push_back(*(std::min_element(std::begin(groups[g]), std::end(groups[g]))));
+		collapsed += groups[g].size() - 1;
+	}
 
 	auto aut2 = spot::make_twa_graph(aut->get_dict());
 	aut2->copy_ap_of(aut);
 	aut2->copy_acceptance_of(aut);
-	aut2->new_states(aut->num_states() - states.size() + 1);
+	aut2->new_states(ns - collapsed);
 
-	std::vector<unsigned> states_v;
+	// the representatives get their numbers first, the other collapsed states then share them
+	std::vector<unsigned> states_v(ns);
 	unsigned j = 0;
-	for (unsigned i = 0, ns = aut->num_states(); i < ns; ++i) {
-		if (std::find(std::begin(states), std::end(states), i) != std::end(states)) {
-			states_v.push_back(new_state);
-			if (i == new_state) {
-				++j;
-			}
-		} else {
-			states_v.push_back(j);
-			++j;
+	for (unsigned i = 0; i < ns; ++i) {
+		if (group_of[i] == -1 || representatives[group_of[i]] == i) {
+			states_v[i] = j++;
 		}
 	}
-
-	if (std::find(std::begin(states), std::end(states), init_state) != std::end(states)) {
-		aut2->set_init_state(new_state);
-	} else {
-		aut2->set_init_state(states_v[init_state]);
+	for (unsigned i = 0; i < ns; ++i) {
+		if (group_of[i] != -1) {
+			states_v[i] = states_v[representatives[group_of[i]]];
+		}
 	}
 
+	aut2->set_init_state(states_v[aut->get_init_state_number()]);
+
+	preds.assign(aut2->num_states(), std::vector<unsigned>());
 	for (auto& edge : aut->edges()) {
-		if (std::find(std::begin(states), std::end(states), edge.src) == std::end(states)
-			&& std::find(std::begin(states), std::end(states), edge.dst) == std::end(states)) {
-			aut2->new_edge(states_v[edge.src], states_v[edge.dst], edge.cond, edge.acc);
+		if (group_of[edge.src] == -1 && group_of[edge.dst] == -1) {
+			new_indexed_edge(aut2, preds, states_v[edge.src], states_v[edge.dst], edge.cond, edge.acc);
 		}
 	}
 
-	return { aut2, new_state, states_v };
+	std::vector<unsigned> new_states;
+	for (auto rep : representatives) {
+		new_states.push_back(states_v[rep]);
+	}
+
+	return { aut2, new_states, states_v };
 }
 
-void add_edges(spot::twa_graph_ptr aut, state_info& si, unsigned new_state, std::vector<unsigned> states, std::vector<unsigned> acc) {
+void add_edges(spot::twa_graph_ptr aut, predecessor_index& preds, state_info& si, unsigned new_state, std::vector<unsigned> states, std::vector<unsigned> acc) {
 	for (auto& edge : si.inE) {
-		aut->new_edge(states[edge.src], new_state, edge.cond);
+		new_indexed_edge(aut, preds, states[edge.src], new_state, edge.cond);
 		edge.dst = edge.src;
 	}
 
 	for (auto& edge : si.outE) {
 		if (states[edge.dst] != new_state) {
-			aut->new_edge(new_state, states[edge.dst], edge.cond);
+			new_indexed_edge(aut, preds, new_state, states[edge.dst], edge.cond);
 		}
 	}
 
 	for (auto& edge : si.loops) {
 		if (edge.cond != bddfalse) {
-			aut->new_edge(new_state, new_state, edge.cond, edge.acc | spot::acc_cond::mark_t(std::begin(acc), std::end(acc)));
+			new_indexed_edge(aut, preds, new_state, new_state, edge.cond, edge.acc | spot::acc_cond::mark_t(std::begin(acc), std::end(acc)));
 		}
 	}
 }
 
-maybe<state_info> check_simplifiability(spot::twa_graph_ptr aut, unsigned base_state, unsigned state2) {
+// a run staying on rejecting loops of the collapsed state is rejecting, so it may
+// read them from the base state; with no Fin in the acceptance, a loop without
+// marks is rejecting unless the condition is true
+bool is_rejecting_loop(spot::twa_graph_ptr aut, const edge_t& loop) {
+	return loop.acc.count() == 0 && !aut->acc().accepting(loop.acc);
+}
+
+maybe<state_info> check_simplifiability(spot::twa_graph_ptr aut, const predecessor_index& preds, inclusion_oracle& oracle, unsigned base_state, unsigned state2) {
 	auto state2_loops = get_loops(aut, state2);
 	auto loops = get_loops(aut, base_state);
 	if (loops.size() != 1) {
@@ -297,7 +633,7 @@ maybe<state_info> check_simplifiability(spot::twa_graph_ptr aut, unsigned base_s
 		return maybe<state_info>::nothing();
 	}
 
-	auto inEdges = check_in_edges(aut, base_state, state2);
+	auto inEdges = check_in_edges(aut, preds, base_state, state2);
 	if (inEdges.isNothing()) {
 		return maybe<state_info>::nothing();
 	}
@@ -308,12 +644,12 @@ maybe<state_info> check_simplifiability(spot::twa_graph_ptr aut, unsigned base_s
 	}
 
 	for (auto& loop : state2_loops) {
-		if (loop.acc.count() != 0) {
-			if (!bdd_implies(loop.cond, c_edge_cond.fromJust()) && check_snd_pattern(aut, loop, c_edge_cond.fromJust(), base_state, state2).isNothing()) {
+		if (!is_rejecting_loop(aut, loop)) {
+			if (!bdd_implies(loop.cond, c_edge_cond.fromJust()) && check_snd_pattern(aut, oracle, loop, c_edge_cond.fromJust(), base_state, state2).isNothing()) {
 				return maybe<state_info>::nothing();
 			}
 		} else {
-			if (!bdd_implies(loop.cond, b_loop_edge.cond) && check_snd_pattern(aut, loop, b_loop_edge.cond, base_state, state2).isNothing()) {
+			if (!bdd_implies(loop.cond, b_loop_edge.cond) && check_snd_pattern(aut, oracle, loop, b_loop_edge.cond, base_state, state2).isNothing()) {
 				return maybe<state_info>::nothing();
 			}
 		}
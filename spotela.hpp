@@ -21,8 +21,11 @@
 #ifndef SPOTELA_H
 #define SPOTELA_H
 #include <algorithm>
+#include <chrono>
+#include <map>
 #include <numeric>
 #include <tuple>
+#include <utility>
 #include <spot/graph/graph.hh>
 #include <spot/twa/acc.hh>
 #include <spot/twaalgos/cleanacc.hh>
@@ -34,6 +37,32 @@
 
 typedef spot::twa_graph::graph_t::edge_storage_t edge_t;
 
+// the numbers of the edges entering each state, in the order of creation
+typedef std::vector<std::vector<unsigned>> predecessor_index;
+
+// memoised language inclusion between the states of the automaton
+// being simplified; it is kept across the iterations of spotela_simplify
+// and has to be value-initialised
+typedef struct {
+	// the automaton of each state, see create_aut_from_state
+	std::map<unsigned, spot::twa_graph_ptr> state_auts;
+	// the known results of L(state1) ⊆ L(state2)
+	std::map<std::pair<unsigned, unsigned>, bool> results;
+	// simulated_by[p][q] is true if q directly simulates p
+	// computed on demand, kept for the states the simplification does not affect
+	std::vector<std::vector<bool>> simulated_by;
+	bool simulation_computed;
+	// the number of checks answered by each tier of implies_language
+	unsigned cached_answers;
+	unsigned successor_answers;
+	unsigned simulation_answers;
+	unsigned contains_answers;
+	// the cost of the simulation and of spot::contains, for -x4
+	unsigned simulation_pair_checks;
+	double simulation_seconds;
+	double contains_seconds;
+} inclusion_oracle;
+
 typedef struct {
 	std::vector<edge_t> inE;
 	std::vector<edge_t> outE;
@@ -43,22 +72,37 @@ typedef struct {
 	edge_t b;
 } state_info;
 
+typedef struct {
+	unsigned base_state;
+	std::vector<state_info> state_infos;
+} simplification_group;
+
 std::vector<edge_t> get_loops(spot::twa_graph_ptr aut, unsigned state);
 std::vector<edge_t> out_edges(spot::twa_graph_ptr aut, unsigned state1, unsigned state2);
-std::vector<edge_t> in_edges(spot::twa_graph_ptr aut, unsigned state1, unsigned state2);
+predecessor_index build_predecessor_index(spot::twa_graph_ptr aut);
+unsigned new_indexed_edge(spot::twa_graph_ptr aut, predecessor_index& preds, unsigned src, unsigned dst, bdd cond, spot::acc_cond::mark_t acc = spot::acc_cond::mark_t());
+std::vector<edge_t> in_edges(spot::twa_graph_ptr aut, const predecessor_index& preds, unsigned state1, unsigned state2);
 maybe<std::vector<edge_t>> check_out_edges(spot::twa_graph_ptr aut, unsigned state1, unsigned state2);
-maybe<std::vector<edge_t>> check_in_edges(spot::twa_graph_ptr aut, unsigned state1, unsigned state2);
-maybe<state_info> check_simplifiability(spot::twa_graph_ptr aut, unsigned base_state, unsigned state2);
+maybe<std::vector<edge_t>> check_in_edges(spot::twa_graph_ptr aut, const predecessor_index& preds, unsigned state1, unsigned state2);
+bool is_rejecting_loop(spot::twa_graph_ptr aut, const edge_t& loop);
+maybe<state_info> check_simplifiability(spot::twa_graph_ptr aut, const predecessor_index& preds, inclusion_oracle& oracle, unsigned base_state, unsigned state2);
 bool is_one_state_scc(spot::scc_info si, unsigned scc);
 bool has_successors(spot::scc_info si, unsigned scc);
-spot::twa_graph_ptr build_simplified_automaton(spot::twa_graph_ptr aut, unsigned base_state, std::vector<state_info> state_infos);
+spot::twa_graph_ptr build_simplified_automaton(spot::twa_graph_ptr aut, predecessor_index& preds, inclusion_oracle& oracle, std::vector<simplification_group> groups);
 maybe<bdd> get_connecting_edge_condition(spot::twa_graph_ptr aut, unsigned state1, unsigned state2, bdd b_loop_cond);
 spot::twa_graph_ptr create_aut_from_state(spot::twa_graph_ptr aut, unsigned state);
-spot::twa_graph_ptr simplify_one_scc(spot::twa_graph_ptr aut);
+void block_neighbourhood(spot::twa_graph_ptr aut, const predecessor_index& preds, std::vector<bool>& blocked, const std::vector<unsigned>& states);
+spot::twa_graph_ptr simplify_sccs(spot::twa_graph_ptr aut, predecessor_index& preds, inclusion_oracle& oracle);
 spot::twa_graph_ptr spotela_simplify(spot::twa_graph_ptr aut);
-bool implies_language(spot::twa_graph_ptr aut, unsigned state1, unsigned state2);
-maybe<edge_t> check_snd_pattern(spot::twa_graph_ptr aut, edge_t edge, bdd c_edge_cond, unsigned state1, unsigned state2);
-std::tuple<spot::twa_graph_ptr, unsigned, std::vector<unsigned>> copy_aut(spot::twa_graph_ptr aut, std::vector<unsigned> states);
-void add_edges(spot::twa_graph_ptr aut, state_info& si, unsigned new_state, std::vector<unsigned> states, std::vector<unsigned> acc);
+bool implies_language(spot::twa_graph_ptr aut, inclusion_oracle& oracle, unsigned state1, unsigned state2);
+bool mark_dominated(const std::pair<spot::acc_cond::mark_t, spot::acc_cond::mark_t>& inf_fin, spot::acc_cond::mark_t acc1, spot::acc_cond::mark_t acc2);
+bool covered_by_same_successors(spot::twa_graph_ptr aut, unsigned state1, unsigned state2);
+bool simulation_step_holds(spot::twa_graph_ptr aut, const std::pair<spot::acc_cond::mark_t, spot::acc_cond::mark_t>& inf_fin, const std::vector<std::vector<bool>>& simulated_by, unsigned p, unsigned q);
+std::vector<std::vector<bool>> compute_direct_simulation(spot::twa_graph_ptr aut, unsigned& pair_checks);
+std::vector<bool> states_reaching(spot::twa_graph_ptr aut, const predecessor_index& preds, const std::vector<unsigned>& states);
+void remap_inclusion_oracle(inclusion_oracle& oracle, const std::vector<bool>& affected, const std::vector<unsigned>& states_v);
+maybe<edge_t> check_snd_pattern(spot::twa_graph_ptr aut, inclusion_oracle& oracle, edge_t edge, bdd c_edge_cond, unsigned state1, unsigned state2);
+std::tuple<spot::twa_graph_ptr, std::vector<unsigned>, std::vector<unsigned>> copy_aut(spot::twa_graph_ptr aut, predecessor_index& preds, std::vector<std::vector<unsigned>> groups);
+void add_edges(spot::twa_graph_ptr aut, predecessor_index& preds, state_info& si, unsigned new_state, std::vector<unsigned> states, std::vector<unsigned> acc);
 std::vector<unsigned> set_fin_cond(spot::twa_graph_ptr aut, unsigned n);
 #endif
@@ -0,0 +1,111 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+#include <spot/tl/print.hh>
+#include "automaton.hpp"
+#include "telemetry.hpp"
+#include "utils.hpp"
+
+std::string telemetry_formula;
+
+void set_telemetry_formula(spot::formula f) {
+	telemetry_formula = spot::str_psl(f);
+}
+
+// returns the peak resident set size in kilobytes
+long get_maxrss() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+// writes s as a JSON string
+void print_json_string(std::ostream& out, const std::string& s) {
+	out << '"';
+	for (unsigned char c : s) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (c < 0x20) {
+			out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+// the innermost phase being measured
+phase_telemetry* current_phase = nullptr;
+
+phase_telemetry::phase_telemetry(const char* phase) : phase(phase), enabled(o_debug & 4), parent(nullptr), depth(0), children_ms(0) {
+	if (enabled) {
+		parent = current_phase;
+		depth = parent == nullptr ? 0 : parent->depth + 1;
+		current_phase = this;
+
+		start = std::chrono::steady_clock::now();
+		start_maxrss = get_maxrss();
+		start_bdd_nodes = bdd_getnodenum();
+		start_product_edges = product_edge_count;
+	}
+}
+
+void phase_telemetry::count(const char* key, long value) {
+	if (enabled) {
+		counts.emplace_back(key, value);
+	}
+}
+
+phase_telemetry::~phase_telemetry() {
+	if (!enabled) {
+		return;
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	int bdd_nodes = bdd_getnodenum();
+
+	current_phase = parent;
+	if (parent != nullptr) {
+		parent->children_ms += elapsed.count();
+	}
+
+	// compose the line first so that it is written at once
+	std::ostringstream line;
+	line << "{\"formula\":";
+	print_json_string(line, telemetry_formula);
+	line << ",\"phase\":\"" << phase << '"'
+		<< ",\"depth\":" << depth
+		<< ",\"time_ms\":" << elapsed.count()
+		<< ",\"self_ms\":" << elapsed.count() - children_ms
+		<< ",\"maxrss_delta_kb\":" << get_maxrss() - start_maxrss
+		<< ",\"bdd_nodes\":" << bdd_nodes
+		<< ",\"bdd_nodes_delta\":" << bdd_nodes - start_bdd_nodes
+		<< ",\"product_edges\":" << product_edge_count - start_product_edges;
+
+	for (auto& c : counts) {
+		line << ",\"" << c.first << "\":" << c.second;
+	}
+
+	line << "}\n";
+	std::cerr << line.str() << std::flush;
+}
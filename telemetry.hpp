@@ -0,0 +1,58 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+#include <spot/tl/formula.hh>
+
+// sets the formula reported with the following phases
+void set_telemetry_formula(spot::formula f);
+
+// measures a phase of the translation from its construction to its
+// destruction; with -x4, the phase is then printed to STDERR as a line
+// of JSON with the wall time, the growth of the peak RSS, the BDD nodes
+// in use, the SLAA edge products created and the counts added by count()
+// phases may be nested; the line also contains the depth of the phase and
+// its self time, i.e. the wall time without the time of the nested phases
+class phase_telemetry {
+	const char* phase;
+	bool enabled;
+	// the innermost enclosing phase, nullptr at the top level
+	phase_telemetry* parent;
+	unsigned depth;
+	double children_ms;
+	std::vector<std::pair<const char*, long>> counts;
+	std::chrono::steady_clock::time_point start;
+	long start_maxrss;
+	int start_bdd_nodes;
+	unsigned long start_product_edges;
+
+public:
+	phase_telemetry(const char* phase);
+	~phase_telemetry();
+
+	// adds a number (e.g. of states or edges) to the record
+	void count(const char* key, long value);
+};
+
+#endif
@@ -0,0 +1,208 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+#include <stdexcept>
+#include <spot/tl/parse.hh>
+#include "nondeterministic.hpp"
+#include "translator.hpp"
+#include "utils.hpp"
+
+translator_options options_from_arguments(std::map<std::string, std::string>& args) {
+	translator_options o;
+
+	o.try_ltl2tgba_spotela = std::stoi(args["b"]);
+	o.slaa_trans_red = std::stoi(args["c"]);
+	o.single_init_state = std::stoi(args["i"]);
+	o.slaa_cache = std::stoi(args["C"]);
+	o.slaa_determ = std::stoi(args["d"]);
+	o.eq_level = std::stoi(args["e"]);
+	o.ltl_split = std::stoi(args["l"]);
+	o.mergeable_info = std::stoi(args["m"]);
+	o.try_negation = std::stoi(args["n"]);
+	o.simplify_formula = std::stoi(args["s"]);
+	o.ac_filter_fin = std::stoi(args["t"]);
+	o.debug = std::stoi(args["x"]);
+
+	o.deterministic = std::stoi(args["D"]);
+	o.portfolio = std::stoi(args["P"]);
+
+	o.time_budget = std::stoi(args["T"]);
+	o.state_budget = std::stoi(args["N"]);
+	o.bdd_budget = std::stoi(args["B"]);
+	o.budget_cutoff = std::stoi(args["k"]);
+	o.prescreen = std::stoi(args["z"]);
+	o.ap_clustering = std::stoi(args["A"]);
+	o.check_lazy = std::stoi(args["L"]);
+
+	o.u_merge_level = std::stoi(args["F"]);
+	o.g_merge_level = std::stoi(args["G"]);
+	o.disj_merging = std::stoi(args["O"]);
+	o.x_single_succ = std::stoi(args["X"]);
+
+	// -O1 implies -i1
+	o.single_init_state = o.single_init_state || o.disj_merging;
+
+	// -x2 implies -b1 (mind the bitwise operations)
+	if (o.debug & 2) {
+		o.try_ltl2tgba_spotela = o.try_ltl2tgba_spotela | 1;
+	}
+
+	return o;
+}
+
+translator_options default_options() {
+	// parse_arguments fills in the defaults only if some flag is given
+	// and -x0 is the default value of -x
+	char name[] = "ltl3tela";
+	char flag[] = "-x0";
+	char* argv[] = { name, flag };
+
+	auto args = parse_arguments(2, argv);
+	return options_from_arguments(args);
+}
+
+translator_options current_options() {
+	translator_options o;
+
+	o.try_ltl2tgba_spotela = o_try_ltl2tgba_spotela;
+	o.slaa_trans_red = o_slaa_trans_red;
+	o.single_init_state = o_single_init_state;
+	o.slaa_cache = o_slaa_cache;
+	o.slaa_determ = o_slaa_determ;
+	o.eq_level = o_eq_level;
+	o.ltl_split = o_ltl_split;
+	o.mergeable_info = o_mergeable_info;
+	o.try_negation = o_try_negation;
+	o.simplify_formula = o_simplify_formula;
+	o.ac_filter_fin = o_ac_filter_fin;
+	o.debug = o_debug;
+
+	o.deterministic = o_deterministic;
+	o.portfolio = o_portfolio;
+
+	o.time_budget = o_time_budget;
+	o.state_budget = o_state_budget;
+	o.bdd_budget = o_bdd_budget;
+	o.budget_cutoff = o_budget_cutoff;
+	o.prescreen = o_prescreen;
+	o.ap_clustering = o_ap_clustering;
+	o.check_lazy = o_check_lazy;
+
+	o.u_merge_level = o_u_merge_level;
+	o.g_merge_level = o_g_merge_level;
+	o.disj_merging = o_disj_merging;
+	o.x_single_succ = o_x_single_succ;
+
+	return o;
+}
+
+void apply_options(const translator_options& o) {
+	o_try_ltl2tgba_spotela = o.try_ltl2tgba_spotela;
+	o_slaa_trans_red = o.slaa_trans_red;
+	o_single_init_state = o.single_init_state;
+	o_slaa_cache = o.slaa_cache;
+	o_slaa_determ = o.slaa_determ;
+	o_eq_level = o.eq_level;
+	o_ltl_split = o.ltl_split;
+	o_mergeable_info = o.mergeable_info;
+	o_try_negation = o.try_negation;
+	o_simplify_formula = o.simplify_formula;
+	o_ac_filter_fin = o.ac_filter_fin;
+	o_debug = o.debug;
+
+	o_deterministic = o.deterministic;
+	o_portfolio = o.portfolio;
+
+	o_time_budget = o.time_budget;
+	o_state_budget = o.state_budget;
+	o_bdd_budget = o.bdd_budget;
+	o_budget_cutoff = o.budget_cutoff;
+	o_prescreen = o.prescreen;
+	o_ap_clustering = o.ap_clustering;
+	o_check_lazy = o.check_lazy;
+
+	o_u_merge_level = o.u_merge_level;
+	o_g_merge_level = o.g_merge_level;
+	o_disj_merging = o.disj_merging;
+	o_x_single_succ = o.x_single_succ;
+}
+
+void set_options(std::map<std::string, std::string>& args) {
+	apply_options(options_from_arguments(args));
+}
+
+// drops the SLAA fragments of -C at the end of its lifetime so that
+// they do not pile up in a long-running process
+class fragment_cache_guard {
+public:
+	~fragment_cache_guard() {
+		clear_slaa_fragment_cache();
+	}
+};
+
+// puts the options in force for its lifetime and then restores the previous ones
+class options_guard {
+	translator_options saved;
+
+public:
+	options_guard(const translator_options& options) : saved(current_options()) {
+		apply_options(options);
+	}
+
+	~options_guard() {
+		apply_options(saved);
+	}
+};
+
+translator::translator(spot::bdd_dict_ptr dict /* = nullptr */) : translator(default_options(), dict) {}
+
+translator::translator(const translator_options& options, spot::bdd_dict_ptr dict /* = nullptr */) : options(options), dict(dict ? dict : spot::make_bdd_dict()) {}
+
+translator_options& translator::get_options() {
+	return options;
+}
+
+spot::bdd_dict_ptr translator::get_dict() const {
+	return dict;
+}
+
+spot::twa_graph_ptr translator::run(spot::formula f) {
+	options_guard guard(options);
+	fragment_cache_guard cache_guard;
+
+	if (o_mergeable_info) {
+		// -m only prints the answer and exits the process
+		throw std::runtime_error("The mergeability check is not available in the library.");
+	}
+
+	// the SLAA is not requested, so none is returned
+	auto nwa = std::get<0>(build_best_nwa(f, dict));
+
+	if (o_ltl_split) {
+		auto nwa_prod = build_product_nwa(simplify_formula(f), dict).first;
+		nwa = compare_automata(nwa, nwa_prod).first;
+	}
+
+	return nwa;
+}
+
+spot::twa_graph_ptr translator::run(const std::string& formula) {
+	return run(spot::parse_formula(formula));
+}
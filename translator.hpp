@@ -0,0 +1,99 @@
+/*
+    Copyright (c) 2020 Juraj Major
+
+    This file is part of LTL3TELA.
+
+    LTL3TELA is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    LTL3TELA is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRANSLATOR_H
+#define TRANSLATOR_H
+#include <map>
+#include <string>
+#include <spot/tl/formula.hh>
+#include <spot/twa/bdddict.hh>
+#include <spot/twa/twagraph.hh>
+
+// the options of the translation; the letters refer to the flags
+// of ./ltl3tela, see ./ltl3tela -h for their meaning
+typedef struct {
+	unsigned try_ltl2tgba_spotela;	// -b
+	unsigned slaa_trans_red;		// -c
+	bool single_init_state;			// -i
+	bool slaa_cache;				// -C
+	unsigned slaa_determ;			// -d
+	unsigned eq_level;				// -e
+	bool ltl_split;					// -l
+	unsigned mergeable_info;		// -m
+	bool try_negation;				// -n
+	bool simplify_formula;			// -s
+	bool ac_filter_fin;				// -t
+	unsigned debug;					// -x
+
+	bool deterministic;				// -D
+	bool portfolio;					// -P
+
+	unsigned time_budget;			// -T
+	unsigned state_budget;			// -N
+	unsigned bdd_budget;			// -B
+	bool budget_cutoff;				// -k
+	unsigned prescreen;				// -z
+	bool ap_clustering;				// -A
+	bool check_lazy;				// -L
+
+	unsigned u_merge_level;			// -F
+	unsigned g_merge_level;			// -G
+	bool disj_merging;				// -O
+	bool x_single_succ;				// -X
+} translator_options;
+
+// reads the options from the arguments returned by parse_arguments
+translator_options options_from_arguments(std::map<std::string, std::string>& args);
+
+// returns the default options of ./ltl3tela
+translator_options default_options();
+
+// returns the options currently in use (the o_* variables)
+translator_options current_options();
+
+// makes the given options the ones in use
+void apply_options(const translator_options& options);
+
+// sets the o_* options from the parsed arguments
+void set_options(std::map<std::string, std::string>& args);
+
+// translates LTL formulae to automata with its own options and BDD dictionary
+// the options are in force only during run(), so several translators
+// may be used one after another; run() is not thread-safe
+class translator {
+	translator_options options;
+	spot::bdd_dict_ptr dict;
+
+public:
+	// a translator with the default options of ./ltl3tela
+	translator(spot::bdd_dict_ptr dict = nullptr);
+	translator(const translator_options& options, spot::bdd_dict_ptr dict = nullptr);
+
+	translator_options& get_options();
+	spot::bdd_dict_ptr get_dict() const;
+
+	// returns the best automaton found for f, like ./ltl3tela -f f
+	// throws a runtime_error if the translation fails
+	spot::twa_graph_ptr run(spot::formula f);
+
+	// parses the formula first, throws spot::parse_error if it is invalid
+	spot::twa_graph_ptr run(const std::string& formula);
+};
+
+#endif
@@ -17,7 +17,50 @@
     along with LTL3TELA.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <ctime>
+#include <stdexcept>
 #include "utils.hpp"
+#include "telemetry.hpp"
+
+unsigned o_try_ltl2tgba_spotela;	// -b
+unsigned o_slaa_trans_red;	// -c
+bool o_single_init_state;	// -i
+bool o_slaa_cache;			// -C
+unsigned o_slaa_determ;		// -d
+unsigned o_eq_level;		// -e
+bool o_ltl_split;			// -l
+unsigned o_mergeable_info;	// -m
+bool o_try_negation;		// -n
+bool o_simplify_formula;	// -s
+bool o_ac_filter_fin;		// -t
+unsigned o_debug;			// -x
+
+bool o_deterministic;		// -D
+bool o_portfolio;			// -P
+
+unsigned o_time_budget;		// -T
+unsigned o_state_budget;	// -N
+unsigned o_bdd_budget;		// -B
+bool o_budget_cutoff;		// -k
+unsigned o_prescreen;		// -z
+bool o_ap_clustering;		// -A
+bool o_check_lazy;			// -L
+
+unsigned o_u_merge_level;	// -F
+unsigned o_g_merge_level;	// -G
+bool o_disj_merging;		// -O
+bool o_x_single_succ;		// -X
+
+unsigned bdd_gc_count = 0;
+double bdd_gc_seconds = 0;
+
+void count_bdd_gc(int pre, bddGbcStat* stat) {
+	// called with pre = 1 before and pre = 0 after each collection
+	if (!pre) {
+		++bdd_gc_count;
+		bdd_gc_seconds += double(stat->time) / CLOCKS_PER_SEC;
+	}
+}
 
 std::set<std::set<spot::formula>> f_bar(spot::formula f) {
 	std::set<std::set<spot::formula> > r;
@@ -64,26 +107,44 @@ std::map<std::string, std::string> parse_arguments(int argc, char * argv[]) {
 	// the first value in a vector is the default one
 	std::map<std::string, std::vector<std::string>> allowed_values = {
 		{"a", { "0", "2", "3" }},
+		{"A", { "0", "1" }},
 		{"b", { "3", "2", "1", "0" }},
 		{"c", { "3", "0", "1", "2" }},
+		{"C", { "0", "1" }},
 		{"d", { "2", "0", "1" }},
 		{"D", { "0", "1" }},
 		{"e", { "2", "0", "1" }},
 		{"F", { "2", "0", "1", "3" }},
 		{"G", { "2", "0", "1" }},
 		{"i", { "0", "1" }},
+		{"k", { "0", "1" }},
 		{"l", { "1", "0" }},
+		{"L", { "0", "1" }},
 		{"m", { "0", "1", "2" }},
 		{"n", { "1", "0" }},
 		{"o", { "hoa", "dot" }},
 		{"O", { "0", "1" }},
 		{"p", { "2", "1", "3" }},
+		{"P", { "0", "1" }},
 		{"s", { "1", "0" }},
 		{"t", { "1", "0" }},
-		{"x", { "0", "1", "2", "3" }},
+		{"x", { "0", "1", "2", "3", "4", "5", "6", "7" }},
 		{"X", { "0", "1" }},
+		{"z", { "0", "1", "2" }},
 	};
 	std::set<std::string> args_without_values = { "h", "v" };
+	// arguments taking an arbitrary value, without a default one
+	std::set<std::string> args_with_free_values = { "f", "H", "I", "K" };
+	// arguments taking a nonnegative integer, with their default values
+	std::map<std::string, std::string> numeric_values = {
+		{"j", "1"},
+		{"T", "0"},
+		{"M", "1000"},
+		{"Q", "1000"},
+		{"R", "50000"},
+		{"N", "0"},
+		{"B", "0"},
+	};
 
 	for (int i = 1; i < argc; ++i) {
 		if (last_arg_name.empty()) {
@@ -123,7 +184,8 @@ std::map<std::string, std::string> parse_arguments(int argc, char * argv[]) {
 	for (auto& r : result) {
 		if (allowed_values.count(r.first) == 0
 			&& args_without_values.find(r.first) == std::end(args_without_values)
-			&& r.first != "f") {
+			&& args_with_free_values.find(r.first) == std::end(args_with_free_values)
+			&& numeric_values.count(r.first) == 0) {
 			// flag not supported
 			result.clear();
 			break;
@@ -168,6 +230,25 @@ std::map<std::string, std::string> parse_arguments(int argc, char * argv[]) {
 		}
 	}
 
+	for (auto& val : numeric_values) {
+		if (result.empty()) {
+			break;
+		}
+
+		if (result.count(val.first) == 0) {
+			result[val.first] = val.second;
+		} else if (result[val.first].empty() || result[val.first].find_first_not_of("0123456789") != std::string::npos) {
+			result.clear();
+		} else {
+			// the values are read by std::stoi, so they have to fit into int
+			try {
+				std::stoi(result[val.first]);
+			} catch (std::out_of_range&) {
+				result.clear();
+			}
+		}
+	}
+
 	return result;
 }
 
@@ -178,8 +259,12 @@ std::map<std::string, std::string> parse_arguments(int argc, char * argv[]) {
 // 4. choose automaton with smaller number of acc. sets
 // 5. return aut1
 std::pair<spot::twa_graph_ptr, std::string> compare_automata(spot::twa_graph_ptr aut1, spot::twa_graph_ptr aut2, std::string stats_id1, std::string stats_id2) {
+	phase_telemetry telemetry("compare_automata");
+
 	auto ns1 = aut1->num_states();
 	auto ns2 = aut2->num_states();
+	telemetry.count("na_states1", ns1);
+	telemetry.count("na_states2", ns2);
 
 	auto p1 = std::make_pair(aut1, stats_id1);
 	auto p2 = std::make_pair(aut2, stats_id2);
@@ -252,6 +337,8 @@ std::pair<spot::twa_graph_ptr, std::string> compare_automata(spot::twa_graph_ptr
 }
 
 spot::formula simplify_formula(spot::formula f) {
+	phase_telemetry telemetry("simplify_formula");
+
 	f = spot::negative_normal_form(spot::unabbreviate(f));
 
 	if (o_simplify_formula) {
@@ -274,7 +361,7 @@ bool is_suspendable(spot::formula f) {
 	}
 
 	if (f.is(spot::op::F)) {
-		return f[0].is_universal() || is_suspendable(f[1]);
+		return f[0].is_universal() || is_suspendable(f[0]);
 	}
 
 	if (f.is(spot::op::U)) {
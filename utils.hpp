@@ -26,6 +26,8 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <cstdint>
+#include <functional>
 #include <bddx.h>
 #include <spot/tl/formula.hh>
 #include <spot/tl/parse.hh>
@@ -39,6 +41,7 @@
 extern unsigned o_try_ltl2tgba_spotela;	// -b
 extern unsigned o_slaa_trans_red;	// -c
 extern bool o_single_init_state;	// -i
+extern bool o_slaa_cache;			// -C
 extern unsigned o_slaa_determ;		// -d
 extern unsigned o_eq_level;			// -e
 extern bool o_ltl_split;			// -l
@@ -49,6 +52,15 @@ extern bool o_ac_filter_fin;		// -t
 extern unsigned o_debug;			// -x
 
 extern bool o_deterministic;		// -D
+extern bool o_portfolio;			// -P
+
+extern unsigned o_time_budget;		// -T
+extern unsigned o_state_budget;		// -N
+extern unsigned o_bdd_budget;		// -B
+extern bool o_budget_cutoff;		// -k
+extern unsigned o_prescreen;		// -z
+extern bool o_ap_clustering;		// -A
+extern bool o_check_lazy;			// -L
 
 extern unsigned o_u_merge_level;	// -F
 extern unsigned o_g_merge_level;	// -G
@@ -71,6 +83,35 @@ spot::formula simplify_formula(spot::formula f);
 // Babiak et al - LTL to Büchi Automata Translation: Fast and More Deterministic
 bool is_suspendable(spot::formula f);
 
+// the garbage collections of BuDDy so far and their total time in seconds
+extern unsigned bdd_gc_count;
+extern double bdd_gc_seconds;
+
+// BuDDy's GC handler that counts the collections instead of printing them
+void count_bdd_gc(int pre, bddGbcStat* stat);
+
+// hash of a sorted set of numbers
+// allows to use sets of states as keys of unordered containers
+struct set_hash {
+	template<typename S> size_t operator()(const S& s) const {
+		size_t h = s.size();
+		for (auto i : s) {
+			h ^= std::hash<unsigned>()(i) + 0x9e3779b9 + (h << 6) + (h >> 2);
+		}
+		return h;
+	}
+};
+
+// 64-bit Bloom signature of a set of numbers
+// if A ⊆ B, then the bits of signature(A) are included in signature(B)
+template<typename S> uint64_t set_signature(const S& s) {
+	uint64_t sig = 0;
+	for (auto i : s) {
+		sig |= uint64_t(1) << (i % 64);
+	}
+	return sig;
+}
+
 template<typename T> class maybe {
     T val;
     bool hasVal;